@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "bitkernels.h"
+#include <string.h>
+#include <QtEndian>
+
+//SIMD versions of the kernels are compiled for x86 with GCC/Clang (which
+//can target instruction sets per function and check for them at run
+//time) and for 64 bit MSVC, where SSE2 is always present.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BITKERNELS_X86
+#define BITKERNELS_AVX2
+#define BITKERNELS_TARGET(isa) __attribute__((target(isa)))
+#define BITKERNELS_HAS_SSE2 __builtin_cpu_supports("sse2")
+#ifdef __x86_64__
+#define BITKERNELS_BMI2
+#endif
+#elif defined(_MSC_VER) && defined(_M_X64)
+#include <emmintrin.h>
+#define BITKERNELS_X86
+#define BITKERNELS_TARGET(isa)
+#define BITKERNELS_HAS_SSE2 true
+#endif
+
+void BitKernels::unpackBits(const unsigned char* src, unsigned int shift, size_t count, quint64* out, bool invert) {
+    unsigned char tail[16];
+    size_t bytes = (shift+count+7)/8;
+    size_t words = wordCount(count);
+    size_t i;
+    quint64 flip = invert ? ~0ULL : 0;
+
+    //Each output word is the big endian word at its byte position funnel
+    //shifted by up to 7 bits with the following byte.  That needs 9 bytes
+    //of input, so the last words go through a zero padded copy.
+    for( i=0; i<words && i*8+9 <= bytes; i++ ) {
+        out[i] = ((qFromBigEndian<quint64>(src+i*8) << shift) | (src[i*8+8] >> (8-shift))) ^ flip;
+    }
+    for( ; i<words; i++ ) {
+        memset(tail,0,sizeof(tail));
+        memcpy(tail,src+i*8,bytes-i*8 < 9 ? bytes-i*8 : 9);
+        out[i] = ((qFromBigEndian<quint64>(tail) << shift) | (tail[8] >> (8-shift))) ^ flip;
+    }
+    if( count%64 ) {
+        out[words-1] = out[words-1] & (~0ULL << (64-count%64));
+    }
+}
+
+//Packs 64 byte per bit samples into a word, sample 0 in the most
+//significant bit.  Several implementations exist, packBytes() picks the best one the CPU
+//can run the first time it is called.
+typedef quint64 (*Pack64Func)(const unsigned char* src);
+
+static inline quint64 reverseBits64(quint64 v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return qbswap(v);
+}
+
+static quint64 pack64Scalar(const unsigned char* src) {
+    quint64 mask = 0;
+    int i;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    quint64 v;
+    for( i=0; i<8; i++ ) {
+        //Set the top bit of every non-zero byte, then multiply the eight
+        //flags together into one byte (first sample in the top bit)
+        memcpy(&v,src+i*8,8);
+        v = (((v & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | v) & 0x8080808080808080ULL;
+        mask = (mask << 8) | (((v >> 7) * 0x8040201008040201ULL) >> 56);
+    }
+#else
+    for( i=0; i<64; i++ ) {
+        mask = (mask << 1) | (src[i] != 0);
+    }
+#endif
+    return mask;
+}
+
+#ifdef BITKERNELS_X86
+BITKERNELS_TARGET("sse2") static quint64 pack64Sse2(const unsigned char* src) {
+    const __m128i zero = _mm_setzero_si128();
+    quint64 zeros = 0;
+    int i;
+    for( i=0; i<4; i++ ) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(src+i*16));
+        zeros = zeros | ((quint64)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(v,zero)) << (i*16));
+    }
+    //movemask puts sample 0 in the least significant bit
+    return reverseBits64(~zeros);
+}
+
+#ifdef BITKERNELS_AVX2
+BITKERNELS_TARGET("avx2") static quint64 pack64Avx2(const unsigned char* src) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_loadu_si256((const __m256i*)src);
+    __m256i hi = _mm256_loadu_si256((const __m256i*)(src+32));
+    quint64 zeros = (quint64)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo,zero)) |
+                    ((quint64)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi,zero)) << 32);
+    return reverseBits64(~zeros);
+}
+#endif
+#endif
+
+static Pack64Func selectPack64() {
+#ifdef BITKERNELS_AVX2
+    if( __builtin_cpu_supports("avx2") ) {
+        return pack64Avx2;
+    }
+#endif
+#ifdef BITKERNELS_X86
+    if( BITKERNELS_HAS_SSE2 ) {
+        return pack64Sse2;
+    }
+#endif
+    return pack64Scalar;
+}
+
+void BitKernels::packBytes(const unsigned char* src, size_t count, quint64* out, bool invert) {
+    static const Pack64Func pack64 = selectPack64();
+    quint64 flip = invert ? ~0ULL : 0;
+    size_t words = count/64;
+    size_t i;
+
+    for( i=0; i<words; i++ ) {
+        out[i] = pack64(src+i*64) ^ flip;
+    }
+    if( count%64 ) {
+        out[words] = 0;
+        for( i=words*64; i<count; i++ ) {
+            if( (src[i] != 0) != invert ) {
+                out[words] = out[words] | (1ULL << (63-(i%64)));
+            }
+        }
+    }
+}
+
+void BitKernels::copyBits(quint64* dst, size_t dstBit, const quint64* src, size_t srcBit, size_t count) {
+    unsigned int n, pos;
+    quint64 mask, value;
+    while( count ) {
+        //Fill at most the remainder of the current destination word
+        pos = dstBit%64;
+        n = 64-pos;
+        if( n > count ) {
+            n = count;
+        }
+        value = fetchBits(src,srcBit,n);
+        mask = (n == 64) ? ~0ULL : (((1ULL << n)-1) << (64-pos-n));
+        dst[dstBit/64] = (dst[dstBit/64] & ~mask) | ((value << (64-pos-n)) & mask);
+        dstBit = dstBit + n;
+        srcBit = srcBit + n;
+        count = count - n;
+    }
+}
+
+//Appends the low n (1-64) bits of value to a packed output stream that
+//is built up a word at a time in acc.
+static inline void appendBits(quint64* out, size_t& word, quint64& acc, unsigned int& accBits, quint64 value, unsigned int n) {
+    unsigned int spill;
+    if( accBits+n < 64 ) {
+        acc = (acc << n) | value;
+        accBits = accBits + n;
+    }
+    else {
+        spill = accBits+n-64;
+        out[word++] = (accBits ? acc << (64-accBits) : 0) | (value >> spill);
+        acc = spill ? value & ((1ULL << spill)-1) : 0;
+        accBits = spill;
+    }
+}
+
+#ifdef BITKERNELS_BMI2
+//When several fields fit in one 64 bit window a single pext pulls all of
+//them out at once.  Returns how many fields were gathered, the caller
+//finishes the rest (windows that would read past srcBits) one at a time.
+BITKERNELS_TARGET("bmi2") static size_t gatherPext(quint64* out, size_t& word, quint64& acc, unsigned int& accBits,
+                                                    const quint64* src, size_t srcBit, size_t srcBits,
+                                                    size_t stride, unsigned int width, size_t count) {
+    unsigned int group = (64-width)/stride+1;
+    unsigned int j;
+    quint64 mask = 0;
+    size_t i, bit;
+
+    for( j=0; j<group; j++ ) {
+        mask = mask | (((1ULL << width)-1) << (64-j*stride-width));
+    }
+    for( i=0; i+group <= count; i += group ) {
+        bit = srcBit+i*stride;
+        if( bit+64 > srcBits ) {
+            break;
+        }
+        appendBits(out,word,acc,accBits,_pext_u64(BitKernels::fetchBits(src,bit,64),mask),group*width);
+    }
+    return i;
+}
+
+static bool selectPext() {
+    //pext is microcoded on AMD before Zen 3 and slower than the shifts
+    return __builtin_cpu_supports("bmi2") && !__builtin_cpu_is("znver1") && !__builtin_cpu_is("znver2");
+}
+#endif
+
+void BitKernels::gatherBits(quint64* out, const quint64* src, size_t srcBit, size_t stride, unsigned int width, size_t count) {
+    size_t i = 0;
+    size_t word = 0;
+    unsigned int accBits = 0;
+    quint64 acc = 0;
+
+    if( width > 64 ) {
+        for( i=0; i<count; i++ ) {
+            copyBits(out,i*width,src,srcBit+i*stride,width);
+        }
+        if( (count*width)%64 ) {
+            out[(count*width)/64] &= ~0ULL << (64-(count*width)%64);
+        }
+        return;
+    }
+    if( !width || !count ) {
+        return;
+    }
+
+#ifdef BITKERNELS_BMI2
+    static const bool pext = selectPext();
+    if( pext && stride >= width && stride+width <= 64 ) {
+        //src holds at least the words covering the last field
+        i = gatherPext(out,word,acc,accBits,src,srcBit,
+                       wordCount(srcBit+(count-1)*stride+width)*64,stride,width,count);
+    }
+#endif
+
+    //Fields of up to 64 bits are shifted into a right aligned accumulator
+    //which is flushed a whole word at a time.
+    for( ; i<count; i++ ) {
+        appendBits(out,word,acc,accBits,fetchBits(src,srcBit+i*stride,width),width);
+    }
+    if( accBits ) {
+        out[word] = acc << (64-accBits);
+    }
+}
+
+static inline unsigned int popCount64(quint64 v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (unsigned int)((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+size_t BitKernels::countBits(const quint64* words, size_t bit, size_t count) {
+    size_t ones = 0;
+    size_t word = bit/64;
+    unsigned int shift = bit%64;
+    size_t last;
+    if( count == 0 ) {
+        return 0;
+    }
+    last = (bit+count-1)/64;
+    //Whole words in the middle, partial ones masked at either end
+    if( word == last ) {
+        return popCount64((words[word] << shift) >> (64-count));
+    }
+    ones = popCount64(words[word] << shift);
+    for( word=word+1; word<last; word++ ) {
+        ones = ones + popCount64(words[word]);
+    }
+    return ones + popCount64(words[last] >> (63-(bit+count-1)%64));
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BITKERNELS_H
+#define BITKERNELS_H
+
+#include<QtGlobal>
+#include<stddef.h>
+
+//Helpers for working with bit streams packed MSB first into 64 bit
+//words: bit 0 of a stream is bit 63 of words[0], bit 64 is bit 63 of
+//words[1] and so on.
+namespace BitKernels
+{
+    inline size_t wordCount(size_t bits) {
+        return (bits+63)/64;
+    }
+
+    inline bool testBit(const quint64* words, size_t bit) {
+        return (words[bit/64] >> (63-(bit%64))) & 1;
+    }
+
+    //Returns count (1-64) bits starting at bit, right aligned
+    inline quint64 fetchBits(const quint64* words, size_t bit, unsigned int count) {
+        size_t word = bit/64;
+        unsigned int shift = bit%64;
+        quint64 value = words[word] << shift;
+        if( shift && shift+count > 64 ) {
+            value = value | (words[word+1] >> (64-shift));
+        }
+        return value >> (64-count);
+    }
+
+    //Bit per bit file data (MSB first bytes) starting at bit shift of
+    //src[0] into count packed bits.  Only the bytes holding those bits
+    //are read.  Trailing bits of the last output word are cleared.
+    void unpackBits(const unsigned char* src, unsigned int shift, size_t count, quint64* out, bool invert);
+
+    //Byte per bit file data (any non-zero byte is a one) into count
+    //packed bits.  Trailing bits of the last output word are cleared.
+    //Uses AVX2 or SSE2 when the CPU has them.
+    void packBytes(const unsigned char* src, size_t count, quint64* out, bool invert);
+
+    //Copies count bits between two packed streams.  Bits of dst outside
+    //of the destination range are preserved.
+    void copyBits(quint64* dst, size_t dstBit, const quint64* src, size_t srcBit, size_t count);
+
+    //Collects count fields of width bits, the first at srcBit and each
+    //following one stride bits later, packing them back to back into out.
+    //Trailing bits of the last output word are cleared.
+    void gatherBits(quint64* out, const quint64* src, size_t srcBit, size_t stride, unsigned int width, size_t count);
+
+    //Number of ones among count bits starting at bit
+    size_t countBits(const quint64* words, size_t bit, size_t count);
+}
+
+#endif // BITKERNELS_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "bittransform.h"
+
+BitTransform::BitTransform(int flags) {
+    m_flags = flags;
+}
+
+int BitTransform::flags() const {
+    return m_flags;
+}
+
+bool BitTransform::isIdentity() const {
+    return m_flags == 0;
+}
+
+unsigned int BitTransform::alignment() const {
+    if( m_flags & Swap32 ) {
+        return 32;
+    }
+    if( m_flags & Swap16 ) {
+        return 16;
+    }
+    if( m_flags & LsbFirst ) {
+        return 8;
+    }
+    return 1;
+}
+
+bool BitTransform::needsPrevious() const {
+    return (m_flags & Differential) != 0;
+}
+
+//Each step is a plain loop of shifts and masks over the words, which the
+//compiler turns into SIMD code where the target has it.
+void BitTransform::apply(quint64* words, size_t count, bool previous) const {
+    quint64 carry = previous ? 1 : 0;
+    quint64 v;
+    size_t i;
+
+    if( m_flags & (Swap16|Swap32) ) {
+        for( i=0; i<count; i++ ) {
+            words[i] = ((words[i] >> 8) & 0x00FF00FF00FF00FFULL) | ((words[i] & 0x00FF00FF00FF00FFULL) << 8);
+        }
+    }
+    if( m_flags & Swap32 ) {
+        //Swapping the 16 bit halves after the bytes reverses all four
+        for( i=0; i<count; i++ ) {
+            words[i] = ((words[i] >> 16) & 0x0000FFFF0000FFFFULL) | ((words[i] & 0x0000FFFF0000FFFFULL) << 16);
+        }
+    }
+    if( m_flags & LsbFirst ) {
+        for( i=0; i<count; i++ ) {
+            v = words[i];
+            v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+            v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+            words[i] = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+        }
+    }
+    if( m_flags & Differential ) {
+        for( i=0; i<count; i++ ) {
+            v = words[i];
+            words[i] = v ^ ((v >> 1) | (carry << 63));
+            carry = v & 1;
+        }
+    }
+    if( m_flags & Invert ) {
+        for( i=0; i<count; i++ ) {
+            words[i] = ~words[i];
+        }
+    }
+}
+
+bool BitTransform::operator==(const BitTransform& other) const {
+    return m_flags == other.m_flags;
+}
+
+bool BitTransform::operator!=(const BitTransform& other) const {
+    return m_flags != other.m_flags;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BITTRANSFORM_H
+#define BITTRANSFORM_H
+
+#include<QtGlobal>
+#include<stddef.h>
+
+//Turns the bits stored in a capture into the bits that were on the line.
+//Any combination of flags can be used; they are applied in the order
+//listed, byte order first and inversion last.  Bit n of the stream belongs
+//to byte n/8 (and 16/32 bit word) of the file, so the grouping transforms
+//need whole groups and the differential decode needs the previous bit.
+//Swap16 and Swap32 are alternatives, with both set Swap32 wins.  There is
+//no separate bit reversal: LsbFirst reverses the bits of each byte, and
+//with Swap32 the bits of each 32 bit word.
+class BitTransform
+{
+public:
+    enum Flag {
+        Swap16       = 0x01,    //Swap the bytes of each 16 bit word
+        Swap32       = 0x02,    //Reverse the bytes of each 32 bit word
+        LsbFirst     = 0x04,    //Bytes were stored least significant bit first
+        Differential = 0x08,    //NRZI/differential decode, a change of level is a one
+        Invert       = 0x10
+    };
+
+    BitTransform(int flags=0);
+    int flags() const;
+    bool isIdentity() const;
+    //Stream bits that must be transformed together (1, 8, 16 or 32)
+    unsigned int alignment() const;
+    //True if a bit depends on the one before it
+    bool needsPrevious() const;
+    //Transforms count packed words (see bitkernels.h) in place.  The first
+    //word must start at a multiple of 64 bits into the stream unless
+    //alignment() is 1.  previous is the stream bit just before words[0].
+    void apply(quint64* words, size_t count, bool previous=false) const;
+    bool operator==(const BitTransform& other) const;
+    bool operator!=(const BitTransform& other) const;
+
+private:
+    int m_flags;
+};
+
+#endif // BITTRANSFORM_H
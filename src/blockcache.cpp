@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "blockcache.h"
+#include <QMutexLocker>
+#include <string.h>
+
+//Blocks are page aligned so they can be filled with unbuffered reads
+#define BLOCKCACHE_ALIGNMENT 4096
+
+BlockCache::BlockCache(size_t budget, size_t blockSize) {
+    m_head = 0;
+    m_tail = 0;
+    m_blockSize = blockSize;
+    m_budget = budget;
+    m_hits = 0;
+    m_misses = 0;
+    m_generation = 0;
+}
+
+BlockCache::~BlockCache() {
+    clear();
+}
+
+size_t BlockCache::blockSize() const {
+    return m_blockSize;
+}
+
+size_t BlockCache::budget() const {
+    QMutexLocker lock(&m_mutex);
+    return m_budget;
+}
+
+void BlockCache::setBudget(size_t budget) {
+    QMutexLocker lock(&m_mutex);
+    m_budget = budget;
+    while( m_tail && (size_t)m_blocks.size()*m_blockSize > m_budget ) {
+        release(m_tail);
+    }
+}
+
+bool BlockCache::lookup(quint64 index, size_t offset, size_t length, unsigned char* out, size_t* copied) {
+    QMutexLocker lock(&m_mutex);
+    Block* block = m_blocks.value(index,0);
+    if( block == 0 ) {
+        m_misses++;
+        return false;
+    }
+    m_hits++;
+    if( block != m_head ) {
+        unlink(block);
+        pushFront(block);
+    }
+    *copied = 0;
+    if( offset < block->size ) {
+        *copied = qMin(length,block->size-offset);
+        memcpy(out,block->data+offset,*copied);
+    }
+    return true;
+}
+
+quint64 BlockCache::generation() const {
+    QMutexLocker lock(&m_mutex);
+    return m_generation;
+}
+
+void BlockCache::insert(quint64 index, const unsigned char* data, size_t size, quint64 generation) {
+    QMutexLocker lock(&m_mutex);
+    Block* block = m_blocks.value(index,0);
+    if( m_budget < m_blockSize || generation != m_generation ) {
+        return;
+    }
+    if( block ) {
+        //Another reader filled it first
+        unlink(block);
+    }
+    else if( (size_t)(m_blocks.size()+1)*m_blockSize > m_budget ) {
+        //Reuse the least recently used block
+        block = m_tail;
+        unlink(block);
+        m_blocks.remove(block->index);
+    }
+    else {
+        block = new Block;
+        block->data = (unsigned char*)qMallocAligned(m_blockSize,BLOCKCACHE_ALIGNMENT);
+    }
+    block->index = index;
+    block->size = qMin(size,m_blockSize);
+    memcpy(block->data,data,block->size);
+    m_blocks.insert(index,block);
+    pushFront(block);
+}
+
+bool BlockCache::contains(quint64 index) const {
+    QMutexLocker lock(&m_mutex);
+    return m_blocks.contains(index);
+}
+
+void BlockCache::invalidate(quint64 index) {
+    QMutexLocker lock(&m_mutex);
+    Block* block = m_blocks.value(index,0);
+    if( block ) {
+        release(block);
+    }
+}
+
+void BlockCache::clear() {
+    QMutexLocker lock(&m_mutex);
+    m_generation++;
+    while( m_tail ) {
+        release(m_tail);
+    }
+}
+
+quint64 BlockCache::hits() const {
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+quint64 BlockCache::misses() const {
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+void BlockCache::unlink(Block* block) {
+    if( block->prev ) {
+        block->prev->next = block->next;
+    }
+    else {
+        m_head = block->next;
+    }
+    if( block->next ) {
+        block->next->prev = block->prev;
+    }
+    else {
+        m_tail = block->prev;
+    }
+}
+
+void BlockCache::pushFront(Block* block) {
+    block->prev = 0;
+    block->next = m_head;
+    if( m_head ) {
+        m_head->prev = block;
+    }
+    else {
+        m_tail = block;
+    }
+    m_head = block;
+}
+
+void BlockCache::release(Block* block) {
+    unlink(block);
+    m_blocks.remove(block->index);
+    qFreeAligned(block->data);
+    delete block;
+}
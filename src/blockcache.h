@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include<QtGlobal>
+#include<QHash>
+#include<QMutex>
+
+//Default size of a cached block (a multiple of the page size) and the
+//default memory budget for all blocks of one file
+#define BLOCKCACHE_BLOCK_SIZE (64*1024)
+#define BLOCKCACHE_DEFAULT_BUDGET (64*1024*1024)
+
+//Keeps the most recently used blocks of a file in memory.  Block n holds
+//the bytes from n*blockSize() up to the next block (less at the end of
+//the file).  When the budget is used up the least recently used block is
+//reused.  Safe to use from several threads.
+class BlockCache
+{
+public:
+    BlockCache(size_t budget=BLOCKCACHE_DEFAULT_BUDGET, size_t blockSize=BLOCKCACHE_BLOCK_SIZE);
+    ~BlockCache();
+    size_t blockSize() const;
+    size_t budget() const;
+    void setBudget(size_t budget);
+    //Copies up to length bytes starting at offset within block index into
+    //out.  Returns false if the block is not cached, otherwise sets copied
+    //(short only at the end of the file).
+    bool lookup(quint64 index, size_t offset, size_t length, unsigned char* out, size_t* copied);
+    //Changes on clear().  Readers take it before reading a block and pass
+    //it to insert(), which drops blocks read before a clear.
+    quint64 generation() const;
+    void insert(quint64 index, const unsigned char* data, size_t size, quint64 generation);
+    //Does not count as a hit or miss
+    bool contains(quint64 index) const;
+    void invalidate(quint64 index);
+    void clear();
+    quint64 hits() const;
+    quint64 misses() const;
+
+private:
+    struct Block {
+        quint64 index;
+        size_t size;
+        unsigned char* data;
+        Block* prev;
+        Block* next;
+    };
+    void unlink(Block* block);
+    void pushFront(Block* block);
+    void release(Block* block);
+
+    mutable QMutex m_mutex;
+    QHash<quint64,Block*> m_blocks;
+    Block* m_head;
+    Block* m_tail;
+    size_t m_blockSize;
+    size_t m_budget;
+    quint64 m_hits;
+    quint64 m_misses;
+    quint64 m_generation;
+};
+
+#endif // BLOCKCACHE_H
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "blockreader.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#ifdef TDM_HAVE_URING
+#include <liburing.h>
+#include <errno.h>
+#endif
+
+BlockReader::BlockReader(const RawFile* file) {
+    m_file = file;
+}
+
+BlockReader::~BlockReader() {
+}
+
+//Each pool thread takes the next unread request until none are left
+class BlockReaderTask: public QRunnable
+{
+public:
+    BlockReaderTask(const RawFile* file, BlockReader::Request* requests, size_t count, QAtomicInt* next) {
+        m_file = file;
+        m_requests = requests;
+        m_count = count;
+        m_next = next;
+    }
+    virtual void run() {
+        size_t i;
+        while( (i = (size_t)m_next->fetchAndAddOrdered(1)) < m_count ) {
+            m_requests[i].got = m_file->read(m_requests[i].pos,m_requests[i].len,m_requests[i].buf);
+        }
+    }
+
+private:
+    const RawFile* m_file;
+    BlockReader::Request* m_requests;
+    size_t m_count;
+    QAtomicInt* m_next;
+};
+
+class BlockReader_Pool: public BlockReader
+{
+public:
+    BlockReader_Pool(const RawFile* file): BlockReader(file) {
+        m_pool.setMaxThreadCount(BLOCKREADER_THREADS);
+    }
+    virtual void read(Request* requests, size_t count) {
+        QAtomicInt next(0);
+        size_t i;
+        if( count == 1 ) {
+            requests[0].got = m_file->read(requests[0].pos,requests[0].len,requests[0].buf);
+            return;
+        }
+        //waitForDone() covers every batch in the pool, so batches run
+        //one at a time
+        QMutexLocker lock(&m_mutex);
+        for( i=0; i<qMin(count,(size_t)BLOCKREADER_THREADS); i++ ) {
+            m_pool.start(new BlockReaderTask(m_file,requests,count,&next));
+        }
+        m_pool.waitForDone();
+    }
+
+private:
+    QThreadPool m_pool;
+    QMutex m_mutex;
+};
+
+#ifdef TDM_HAVE_URING
+class BlockReader_Uring: public BlockReader
+{
+public:
+    BlockReader_Uring(const RawFile* file): BlockReader(file) {
+        m_ok = io_uring_queue_init(BLOCKREADER_DEPTH,&m_ring,0) == 0;
+    }
+    virtual ~BlockReader_Uring() {
+        if( m_ok ) {
+            io_uring_queue_exit(&m_ring);
+        }
+    }
+    bool isOk() {
+        return m_ok;
+    }
+    virtual void read(Request* requests, size_t count) {
+        QMutexLocker lock(&m_mutex);
+        struct io_uring_cqe* cqe;
+        size_t next = 0;
+        size_t inflight = 0;
+        size_t i;
+        int ret;
+
+        for( i=0; i<count; i++ ) {
+            requests[i].got = 0;
+        }
+        while( next < count || inflight ) {
+            while( next < count && inflight < BLOCKREADER_DEPTH && submit(requests,next) ) {
+                next++;
+                inflight++;
+            }
+            ret = io_uring_submit_and_wait(&m_ring,1);
+            if( ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY ) {
+                break;
+            }
+            while( io_uring_peek_cqe(&m_ring,&cqe) == 0 ) {
+                i = (size_t)(quintptr)io_uring_cqe_get_data(cqe);
+                ret = cqe->res;
+                io_uring_cqe_seen(&m_ring,cqe);
+                inflight--;
+                if( ret == -EINTR || ret == -EAGAIN ) {
+                    ret = 0;
+                }
+                else if( ret <= 0 ) {
+                    //End of file or an error, the request stays short
+                    continue;
+                }
+                requests[i].got = requests[i].got + ret;
+                //Continue a short read (or retry an interrupted one)
+                if( requests[i].got < requests[i].len && submit(requests,i) ) {
+                    inflight++;
+                }
+            }
+        }
+        if( inflight == 0 && next == count ) {
+            return;
+        }
+        //The ring failed; let what is in flight land, then read the rest directly
+        while( inflight && io_uring_wait_cqe(&m_ring,&cqe) == 0 ) {
+            io_uring_cqe_seen(&m_ring,cqe);
+            inflight--;
+        }
+        for( i=0; i<count; i++ ) {
+            requests[i].got = m_file->read(requests[i].pos,requests[i].len,requests[i].buf);
+        }
+    }
+
+private:
+    bool submit(Request* requests, size_t i) {
+        struct io_uring_sqe* sqe = io_uring_get_sqe(&m_ring);
+        if( sqe == 0 ) {
+            return false;
+        }
+        io_uring_prep_read(sqe,m_file->handle(),requests[i].buf+requests[i].got,
+                           requests[i].len-requests[i].got,requests[i].pos+requests[i].got);
+        io_uring_sqe_set_data(sqe,(void*)(quintptr)i);
+        return true;
+    }
+
+    struct io_uring m_ring;
+    bool m_ok;
+    QMutex m_mutex;
+};
+#endif
+
+BlockReader* BlockReader::create(const RawFile* file) {
+#ifdef TDM_HAVE_URING
+    //io_uring can be missing from the kernel or blocked by seccomp
+    BlockReader_Uring* uring = new BlockReader_Uring(file);
+    if( uring->isOk() ) {
+        return uring;
+    }
+    delete uring;
+#endif
+    return new BlockReader_Pool(file);
+}
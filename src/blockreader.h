@@ -23,26 +23,41 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#ifndef CAPTUREFILE_BYTEPERBIT_H
-#define CAPTUREFILE_BYTEPERBIT_H
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
 
-#include<stdio.h>
-#include"capturefile.h"
+#include<QtGlobal>
+#include<stddef.h>
+#include"rawfile.h"
 
-class CaptureFile_BytePerBit: public CaptureFile
+//Reads submitted to the device at once by a batch (io_uring queue depth
+//or pool threads)
+#define BLOCKREADER_DEPTH 64
+#define BLOCKREADER_THREADS 8
+
+//Reads a batch of blocks of a RawFile with as many requests in flight as
+//the device will take, completing them in whatever order it finishes
+//them.  Uses io_uring where it was built in (TDM_HAVE_URING) and the
+//kernel allows it, otherwise a small pool of threads calling pread().
+class BlockReader
 {
 public:
-    CaptureFile_BytePerBit(QString path, bool invert=false);
-    virtual ~CaptureFile_BytePerBit();
-    virtual size_t tellbit();
-    virtual void seekbit(size_t offset);
-    virtual size_t sizebit();
-    virtual QBitArray* readbit(size_t readlen=1);
+    struct Request {
+        quint64 pos;
+        size_t len;
+        unsigned char* buf;
+        size_t got;             //Set by read(), short only at the end of the file
+    };
+
+    static BlockReader* create(const RawFile* file);
+    virtual ~BlockReader();
+    //Returns once every request is complete.  Safe to call from several
+    //threads at once.
+    virtual void read(Request* requests, size_t count) = 0;
 
-private:
-    FILE* m_fp;
-    size_t m_fileSize;
-    bool m_invert;
+protected:
+    BlockReader(const RawFile* file);
+    const RawFile* m_file;
 };
 
-#endif // CAPTUREFILE_BYTEPERBIT_H
+#endif // BLOCKREADER_H
@@ -24,18 +24,312 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include"capturefile.h"
+#include"bitkernels.h"
 #include<QFileInfo>
+#include<string.h>
+#include<vector>
+
+//Largest span of the file gatherbits() pulls in with a single extractbits()
+#define GATHER_SPAN_LIMIT (8*1024*1024)
+//Bytes extractraw() reads per step
+#define EXTRACT_CHUNK 4096
+//Most blocks prefetchbytes() hands to readblocks() at once
+#define PREFETCH_BATCH BLOCKREADER_DEPTH
+
+//Block buffers are aligned so backends can read into them directly
+//while scanning with O_DIRECT
+static unsigned char* alignedBuffer(std::vector<unsigned char>& buffer, size_t size) {
+    buffer.resize(size+RAWFILE_ALIGN);
+    return (unsigned char*)(((quintptr)buffer.data()+RAWFILE_ALIGN-1) & ~(quintptr)(RAWFILE_ALIGN-1));
+}
 
 CaptureFile::CaptureFile(QString path) {
     m_name = QFileInfo(path).fileName();
+    m_cache = new BlockCache();
+    m_position = 0;
 }
 
 QString CaptureFile::fileName() {
     return m_name;
 }
 
-CaptureFile::~CaptureFile() {}
-size_t CaptureFile::tellbit() { return 0; }
-void CaptureFile::seekbit(size_t offset) { Q_UNUSED(offset); }
-size_t CaptureFile::sizebit() { return 0; }
-QBitArray* CaptureFile::readbit(size_t readlen) { Q_UNUSED(readlen); return 0; }
+CaptureFile::~CaptureFile() {
+    delete m_cache;
+}
+quint64 CaptureFile::tellbit() {
+    return m_position;
+}
+
+void CaptureFile::seekbit(quint64 offset) {
+    m_position = offset;
+}
+
+QBitArray* CaptureFile::readbit(size_t readlen) {
+    std::vector<quint64> words(BitKernels::wordCount(readlen));
+    QBitArray *bits = new QBitArray(readlen);
+    size_t i;
+    extractbits(m_position,readlen,words.data());
+    for( i=0; i<readlen; i++ ) {
+        if( BitKernels::testBit(words.data(),i) ) {
+            bits->setBit(i,true);
+        }
+    }
+    m_position = m_position + readlen;
+    return bits;
+}
+
+quint64 CaptureFile::sizebit() { return 0; }
+quint64 CaptureFile::firstbit() { return 0; }
+void CaptureFile::prefetch(quint64 offset, quint64 length) { Q_UNUSED(offset); Q_UNUSED(length); }
+bool CaptureFile::refresh() { return false; }
+quint64 CaptureFile::changedbit() { return sizebit(); }
+void CaptureFile::beginscan(bool direct) { Q_UNUSED(direct); }
+void CaptureFile::endscan() { }
+void CaptureFile::release(quint64 offset, quint64 length) { Q_UNUSED(offset); Q_UNUSED(length); }
+size_t CaptureFile::readbits(quint64 offset, size_t count, quint64* out) const {
+    Q_UNUSED(offset);
+    memset(out,0,BitKernels::wordCount(count)*sizeof(quint64));
+    return 0;
+}
+
+size_t CaptureFile::extractbits(quint64 offset, size_t count, quint64* out) const {
+    static thread_local std::vector<quint64> scratch;
+    BitTransform transform(m_transform.loadAcquire());
+    quint64 start, end;
+    size_t inside, valid;
+
+    if( transform.isIdentity() ) {
+        return readbits(offset,count,out);
+    }
+    if( transform.alignment() == 1 && !transform.needsPrevious() ) {
+        //Inverting works on any bit, transform what was read in place
+        valid = readbits(offset,count,out);
+        transform.apply(out,BitKernels::wordCount(valid));
+        if( valid%64 ) {
+            out[valid/64] &= ~0ULL << (64-valid%64);
+        }
+        return valid;
+    }
+
+    //Otherwise read whole words of the stream (and the one before for the
+    //differential decode) so that every group is complete
+    start = offset-offset%64;
+    if( transform.needsPrevious() && start > 0 ) {
+        start = start-64;
+    }
+    end = offset+count;
+    end = end+(64-end%64)%64;
+    if( start == offset ) {
+        //out already holds the rounded up range
+        inside = readbits(start,end-start,out);
+        transform.apply(out,BitKernels::wordCount(inside));
+    }
+    else {
+        scratch.resize((end-start)/64);
+        inside = readbits(start,end-start,scratch.data());
+        transform.apply(scratch.data(),BitKernels::wordCount(inside));
+    }
+    valid = inside > offset-start ? qMin((quint64)count,inside-(offset-start)) : 0;
+    if( start == offset ) {
+        memset(out+BitKernels::wordCount(valid),0,(BitKernels::wordCount(count)-BitKernels::wordCount(valid))*sizeof(quint64));
+    }
+    else {
+        memset(out,0,BitKernels::wordCount(count)*sizeof(quint64));
+        BitKernels::copyBits(out,0,scratch.data(),offset-start,valid);
+    }
+    if( valid%64 ) {
+        out[valid/64] &= ~0ULL << (64-valid%64);
+    }
+    return valid;
+}
+
+size_t CaptureFile::gatherbits(quint64 offset, quint64 stride, unsigned int width, size_t count, quint64* out) const {
+    static thread_local std::vector<quint64> scratch;
+    quint64 spanBits;
+    size_t inside, fields, i;
+    size_t valid = 0;
+
+    if( stride == width ) {
+        return extractbits(offset,count*width,out);
+    }
+    memset(out,0,BitKernels::wordCount(count*width)*sizeof(quint64));
+    if( count == 0 || width == 0 ) {
+        return 0;
+    }
+
+    spanBits = (count-1)*stride + width;
+    if( spanBits <= GATHER_SPAN_LIMIT ) {
+        //Read everything from the first to the last field in one pass and
+        //pick the fields out of memory
+        scratch.resize(BitKernels::wordCount(spanBits));
+        inside = extractbits(offset,spanBits,scratch.data());
+        BitKernels::gatherBits(out,scratch.data(),0,stride,width,count);
+        if( inside ) {
+            fields = (inside-1)/stride + 1;
+            valid = (fields-1)*width + qMin((quint64)width,inside-(fields-1)*stride);
+        }
+    }
+    else {
+        //Fields are too far apart for that to pay off; read them one by one
+        scratch.resize(BitKernels::wordCount(width));
+        for( i=0; i<count; i++ ) {
+            inside = extractbits(offset+i*stride,width,scratch.data());
+            if( inside == 0 ) {
+                break;
+            }
+            BitKernels::copyBits(out,i*width,scratch.data(),0,width);
+            valid = valid + inside;
+        }
+    }
+    return valid;
+}
+
+void CaptureFile::setCacheBudget(size_t budget) {
+    m_cache->setBudget(budget);
+}
+
+BlockCache* CaptureFile::cache() const {
+    return m_cache;
+}
+
+void CaptureFile::setTransform(BitTransform transform) {
+    m_transform.storeRelease(transform.flags());
+}
+
+BitTransform CaptureFile::transform() const {
+    return BitTransform(m_transform.loadAcquire());
+}
+
+size_t CaptureFile::readraw(quint64 pos, size_t len, unsigned char* buf) const {
+    Q_UNUSED(pos);
+    Q_UNUSED(len);
+    Q_UNUSED(buf);
+    return 0;
+}
+
+size_t CaptureFile::readbytes(quint64 pos, size_t len, unsigned char* buf) const {
+    static thread_local std::vector<unsigned char> buffer;
+    size_t blockSize = m_cache->blockSize();
+    size_t done = 0;
+    size_t start, n, got;
+    quint64 index, generation;
+    unsigned char* block;
+
+    if( m_cache->budget() < blockSize ) {
+        return readraw(pos,len,buf);
+    }
+    while( done < len ) {
+        index = (pos+done)/blockSize;
+        start = (pos+done)%blockSize;
+        n = qMin(blockSize-start,len-done);
+        if( !m_cache->lookup(index,start,n,buf+done,&got) || got < n ) {
+            //Miss (or a block cached before the file grew), read the whole
+            //block and keep it
+            block = alignedBuffer(buffer,blockSize);
+            generation = m_cache->generation();
+            got = readraw(index*blockSize,blockSize,block);
+            m_cache->insert(index,block,got,generation);
+            got = got > start ? qMin(n,got-start) : 0;
+            memcpy(buf+done,block+start,got);
+        }
+        done = done + got;
+        if( got < n ) {
+            break;
+        }
+    }
+    return done;
+}
+
+size_t CaptureFile::extractraw(quint64 offset, size_t count, quint64* out, bool bytePerBit, quint64 size) const {
+    unsigned char buf[EXTRACT_CHUNK+1];
+    size_t done = 0;
+    size_t valid = 0;
+    size_t chunk, got, bits;
+    quint64 pos;
+
+    memset(out,0,BitKernels::wordCount(count)*sizeof(quint64));
+    while( done < count && offset+done < size ) {
+        //Chunks are a multiple of 64 bits so each one starts on an output word
+        pos = offset+done;
+        chunk = count-done;
+        if( chunk > (bytePerBit ? EXTRACT_CHUNK : EXTRACT_CHUNK*8) ) {
+            chunk = bytePerBit ? EXTRACT_CHUNK : EXTRACT_CHUNK*8;
+        }
+        if( chunk > size-pos ) {
+            chunk = size-pos;
+        }
+        if( bytePerBit ) {
+            //Packs 64 samples per step with SSE2/AVX2 where available
+            bits = readbytes(pos,chunk,buf);
+            BitKernels::packBytes(buf,bits,out+done/64,false);
+        }
+        else {
+            got = readbytes(pos/8,(pos%8+chunk+7)/8,buf)*8;
+            bits = got > pos%8 ? got-pos%8 : 0;
+            if( bits > chunk ) {
+                bits = chunk;
+            }
+            BitKernels::unpackBits(buf,pos%8,bits,out+done/64,false);
+        }
+        valid = valid + bits;
+        if( bits < chunk ) {
+            break;
+        }
+        done = done + chunk;
+    }
+    return valid;
+}
+
+void CaptureFile::readblocks(BlockReader::Request* requests, size_t count) const {
+    size_t i;
+    for( i=0; i<count; i++ ) {
+        requests[i].got = readraw(requests[i].pos,requests[i].len,requests[i].buf);
+    }
+}
+
+void CaptureFile::prefetchbytes(quint64 pos, quint64 len) const {
+    static thread_local std::vector<unsigned char> buffer;
+    static thread_local std::vector<BlockReader::Request> requests;
+    size_t blockSize = m_cache->blockSize();
+    quint64 index, last, generation;
+    bool end = false;
+    size_t i, j;
+    unsigned char* blocks;
+
+    //Anything past the budget would only evict what was just read
+    len = qMin(len,(quint64)m_cache->budget());
+    if( len == 0 || m_cache->budget() < blockSize ) {
+        return;
+    }
+    blocks = alignedBuffer(buffer,PREFETCH_BATCH*blockSize);
+    requests.resize(PREFETCH_BATCH);
+    last = (pos+len-1)/blockSize;
+    index = pos/blockSize;
+    while( index <= last && !end ) {
+        //Collect the next batch of missing blocks and read them together
+        i = 0;
+        for( ; index<=last && i<PREFETCH_BATCH; index++ ) {
+            if( !m_cache->contains(index) ) {
+                requests[i].pos = index*blockSize;
+                requests[i].len = blockSize;
+                requests[i].buf = blocks+i*blockSize;
+                requests[i].got = 0;
+                i++;
+            }
+        }
+        generation = m_cache->generation();
+        readblocks(requests.data(),i);
+        for( j=0; j<i && !end; j++ ) {
+            m_cache->insert(requests[j].pos/blockSize,requests[j].buf,requests[j].got,generation);
+            end = requests[j].got < blockSize;
+        }
+    }
+}
+
+void CaptureFile::releasebytes(quint64 pos, quint64 len) const {
+    size_t blockSize = m_cache->blockSize();
+    quint64 index = (pos+blockSize-1)/blockSize;
+    for( ; (index+1)*blockSize <= pos+len; index++ ) {
+        m_cache->invalidate(index);
+    }
+}
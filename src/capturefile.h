@@ -28,6 +28,21 @@
 
 #include<QString>
 #include<QBitArray>
+#include<QAtomicInt>
+#include<stdio.h>
+#include"blockcache.h"
+#include"bittransform.h"
+#include"blockreader.h"
+
+//Bit offsets are 64 bit everywhere, so the stdio backends need the large
+//file variants of fseek()/ftell() to reach past 2 GB.
+#ifdef Q_OS_WIN
+#define fseek64 _fseeki64
+#define ftell64 _ftelli64
+#else
+#define fseek64 fseeko
+#define ftell64 ftello
+#endif
 
 class CaptureFile
 {
@@ -35,13 +50,84 @@ public:
     CaptureFile(QString path);
     QString fileName();
     virtual ~CaptureFile();
-    virtual size_t tellbit();
-    virtual void seekbit(size_t offset);
-    virtual size_t sizebit();
-    virtual QBitArray* readbit(size_t readlen=1);
+    //Sequential reads from a cursor, for one thread at a time.  Reads at
+    //explicit offsets (extractbits()/gatherbits()) are safe from any
+    //number of threads at once.
+    quint64 tellbit();
+    void seekbit(quint64 offset);
+    QBitArray* readbit(size_t readlen=1);
+    virtual quint64 sizebit();
+    //First bit that can still be read, non-zero only for streams that
+    //let old data go
+    virtual quint64 firstbit();
+    virtual void prefetch(quint64 offset, quint64 length);
+    //Picks up data appended since the file was opened (or last refreshed),
+    //returns true if sizebit() grew
+    virtual bool refresh();
+    //After refresh() returned true, the first bit whose data may have
+    //changed.  Only segment sets change data before the old end, when a
+    //segment that is not the last grows.
+    virtual quint64 changedbit();
+    //Jobs reading the whole file (exports) run as a scan: the OS is told
+    //to read ahead sequentially, and ranges passed to release() are
+    //dropped from the page cache and the block cache so the scan does not
+    //push out everything else.  With direct, reads bypass the page cache
+    //(O_DIRECT) where the backend and file system allow it.  Scans may
+    //overlap (an export while the overview is built), the file leaves scan
+    //mode when the last one ends.
+    virtual void beginscan(bool direct=false);
+    virtual void endscan();
+    virtual void release(quint64 offset, quint64 length);
+    //Copies count bits starting at offset into out, packed MSB first into
+    //64 bit words (see bitkernels.h).  out must hold at least
+    //BitKernels::wordCount(count) words.  Does not move the read position
+    //used by seekbit()/readbit().  Bits past the end of the file are zero.
+    //Returns the number of bits that were inside the file.  The bits go
+    //through transform() on the way.
+    size_t extractbits(quint64 offset, size_t count, quint64* out) const;
+    //Gathers count fields of width bits, the first at offset and each
+    //following one stride bits later (e.g. one timeslot from every frame
+    //of a line), packed back to back into out.  out must hold at least
+    //BitKernels::wordCount(count*width) words.  Returns the number of
+    //gathered bits that were inside the file.
+    virtual size_t gatherbits(quint64 offset, quint64 stride, unsigned int width, size_t count, quint64* out) const;
+    //Memory for recently read blocks of the file, 0 disables the cache
+    void setCacheBudget(size_t budget);
+    BlockCache* cache() const;
+    //Applied to everything read by extractbits()/gatherbits()/readbit().
+    //The block cache holds the file data as stored, so changing this takes
+    //effect on the next read.  Safe to change while other threads read,
+    //each extractbits() call uses one transform throughout.
+    void setTransform(BitTransform transform);
+    BitTransform transform() const;
+
+protected:
+    //extractbits() without the transform, implemented by every backend
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
+    //Reads up to len bytes of the underlying file at byte offset pos,
+    //returns how many were read.  Backends reading through readbytes()
+    //implement this.  Like readbits() it may be called from several
+    //threads at once.
+    virtual size_t readraw(quint64 pos, size_t len, unsigned char* buf) const;
+    //readraw() through the block cache
+    size_t readbytes(quint64 pos, size_t len, unsigned char* buf) const;
+    //extractbits() for files holding bit per bit (MSB first) or byte per
+    //bit data, reading size bits of it through readbytes()
+    size_t extractraw(quint64 offset, size_t count, quint64* out, bool bytePerBit, quint64 size) const;
+    //Reads a batch of blocks for prefetchbytes(), one readraw() after
+    //another unless the backend can have them in flight together
+    virtual void readblocks(BlockReader::Request* requests, size_t count) const;
+    //Loads the blocks holding len bytes at pos into the block cache
+    void prefetchbytes(quint64 pos, quint64 len) const;
+    //Drops the blocks lying entirely inside len bytes at pos from the
+    //block cache
+    void releasebytes(quint64 pos, quint64 len) const;
 
 private:
     QString m_name;
+    BlockCache* m_cache;
+    QAtomicInt m_transform;     //BitTransform flags
+    quint64 m_position;
 };
 
 #endif // CAPTUREFILE_H
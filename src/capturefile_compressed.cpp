@@ -0,0 +1,738 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "capturefile_compressed.h"
+#include "bitkernels.h"
+#include <QFileInfo>
+#include <QFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <string.h>
+#ifdef TDM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef TDM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+//Uncompressed bytes between gzip checkpoints.  A read decompresses at
+//most this much before reaching its data; each checkpoint keeps a 32 KB
+//window (compressed) in memory and in the index file.
+#define GZIP_SPAN (4*1024*1024)
+#define GZIP_WINDOW 32768
+#define GZIP_TRAILER 8
+//Compressed bytes read per step
+#define COMPRESSED_CHUNK (64*1024)
+//Decoded bytes kept behind the decoder.  Reads ahead of it carry on
+//decoding instead of going back to a checkpoint, so reading through a
+//zstd file written as a single frame only decodes it once.
+#define COMPRESSED_SPAN (8*1024*1024)
+//Steps of the progress shown while building an index
+#define INDEX_PROGRESS_STEPS 1000
+
+#define INDEX_MAGIC 0x54444D49
+#define INDEX_VERSION 1
+
+#define ZSTD_FRAME_MAGIC 0xFD2FB528U
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A50U
+#define ZSTD_SKIPPABLE_MASK 0xFFFFFFF0U
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1U
+#define ZSTD_SEEK_FOOTER 9
+#define ZSTD_HEADER_MAX 18
+
+static quint32 readLE32(const unsigned char* p) {
+    return (quint32)p[0] | ((quint32)p[1] << 8) | ((quint32)p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+CaptureFile_Compressed::CaptureFile_Compressed(QString path, bool bytePerBit, QProgressDialog* dlg): CaptureFile(path)
+{
+    m_path = path;
+    m_format = detect(path);
+    m_dataSize = 0;
+    m_fileSize = 0;
+    m_bytePerBit = bytePerBit;
+    m_spanStart = 0;
+    m_decodeIn = 0;
+    m_inPos = 0;
+    m_inSize = 0;
+    m_inflate = 0;
+    m_zstd = 0;
+    m_rawDeflate = false;
+    m_fp = fopen(path.toStdString().c_str(),"rb");
+    if( m_fp == 0 || m_format == None ) {
+        m_index.clear();
+        return;
+    }
+    fseek64(m_fp,0,SEEK_END);
+    m_fileSize = ftell64(m_fp);
+    fseek64(m_fp,0,SEEK_SET);
+
+    if( !loadIndex() ) {
+        if( dlg != 0 ) {
+            dlg->setMinimum(0);
+            dlg->setMaximum(INDEX_PROGRESS_STEPS);
+            dlg->setValue(0);
+        }
+        if( m_format == Gzip ) {
+            buildGzipIndex(dlg);
+        }
+        else if( !readSeekTable() ) {
+            buildZstdIndex(dlg);
+        }
+        //The seek table of a seekable zstd file is as good as an index
+        if( m_index.size() ) {
+            saveIndex();
+        }
+    }
+    if( m_index.size() ) {
+        m_dataSize = m_index.last().out;
+    }
+}
+
+CaptureFile_Compressed::~CaptureFile_Compressed() {
+    stopDecoder();
+    if( m_fp ) {
+        fclose(m_fp);
+    }
+}
+
+CaptureFile_Compressed::Format CaptureFile_Compressed::detect(QString path) {
+    unsigned char magic[4];
+    Format format = None;
+    FILE* fp = fopen(path.toStdString().c_str(),"rb");
+    if( fp == 0 ) {
+        return None;
+    }
+    if( fread(magic,1,4,fp) == 4 ) {
+#ifdef TDM_HAVE_ZLIB
+        if( magic[0] == 0x1F && magic[1] == 0x8B ) {
+            format = Gzip;
+        }
+#endif
+#ifdef TDM_HAVE_ZSTD
+        if( readLE32(magic) == ZSTD_FRAME_MAGIC ||
+            (readLE32(magic) & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC ) {
+            format = Zstd;
+        }
+#endif
+    }
+    fclose(fp);
+    return format;
+}
+
+bool CaptureFile_Compressed::isOpen() {
+    return m_index.size() > 1;
+}
+
+quint64 CaptureFile_Compressed::sizebit() {
+    if( m_bytePerBit ) {
+        return m_dataSize;
+    }
+    return m_dataSize*8;
+}
+
+void CaptureFile_Compressed::prefetch(quint64 offset, quint64 length) {
+    if( offset >= sizebit() ) {
+        return;
+    }
+    length = qMin(length,sizebit()-offset);
+    if( m_bytePerBit ) {
+        prefetchbytes(offset,length);
+    }
+    else {
+        prefetchbytes(offset/8,(offset%8+length+7)/8);
+    }
+}
+
+size_t CaptureFile_Compressed::readbits(quint64 offset, size_t count, quint64* out) const {
+    return extractraw(offset,count,out,m_bytePerBit,m_bytePerBit ? m_dataSize : m_dataSize*8);
+}
+
+size_t CaptureFile_Compressed::readraw(quint64 pos, size_t len, unsigned char* buf) const {
+    QMutexLocker lock(&m_ioMutex);
+    quint64 end;
+
+    if( pos >= m_dataSize ) {
+        return 0;
+    }
+    end = qMin(pos+len,m_dataSize);
+    if( pos < m_spanStart || end > m_spanStart+m_span.size() ) {
+        if( !decode(pos,end) ) {
+            return 0;
+        }
+    }
+    end = qMin(end,m_spanStart+m_span.size());
+    if( end <= pos ) {
+        return 0;
+    }
+    memcpy(buf,m_span.constData()+(pos-m_spanStart),end-pos);
+    return end-pos;
+}
+
+//Decodes up to at least end into m_span, carrying on from where the last
+//decode stopped when that is closer to pos than any checkpoint
+bool CaptureFile_Compressed::decode(quint64 pos, quint64 end) const {
+    int lo = 0;
+    int hi = m_index.size()-1;
+    int mid;
+    quint64 decoded = m_spanStart+m_span.size();
+    quint64 drop;
+    size_t got;
+
+    //Last checkpoint (not counting the end marker) with out <= pos
+    while( hi-lo > 1 ) {
+        mid = (lo+hi)/2;
+        if( m_index[mid].out <= pos ) {
+            lo = mid;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    if( (m_inflate == 0 && m_zstd == 0) || pos < m_spanStart || m_index[lo].out > decoded ) {
+        if( !startDecoder(lo) ) {
+            return false;
+        }
+        decoded = m_spanStart;
+    }
+    while( decoded < end ) {
+        //Keep at most COMPRESSED_SPAN behind the decoder, never anything
+        //from pos on
+        if( m_span.size() > COMPRESSED_SPAN ) {
+            drop = qMin((quint64)m_span.size()-COMPRESSED_SPAN/2,pos > m_spanStart ? pos-m_spanStart : 0);
+            m_span.remove(0,drop);
+            m_spanStart = m_spanStart + drop;
+        }
+        got = decodeMore(qMin(end-decoded,(quint64)COMPRESSED_SPAN/4));
+        if( got == 0 ) {
+            //End of the data or a damaged stream, the next read starts over
+            stopDecoder();
+            break;
+        }
+        decoded = decoded + got;
+    }
+    return pos >= m_spanStart && pos < decoded;
+}
+
+//Empties the span and starts a decoder at checkpoint point
+bool CaptureFile_Compressed::startDecoder(int point) const {
+    const Checkpoint& cp = m_index[point];
+    stopDecoder();
+    m_span.resize(0);
+    m_spanStart = cp.out;
+    m_decodeIn = cp.in;
+    m_inPos = 0;
+    m_inSize = 0;
+#ifdef TDM_HAVE_ZLIB
+    if( m_format == Gzip ) {
+        QByteArray window;
+        int byte;
+        m_inflate = new z_stream;
+        memset(m_inflate,0,sizeof(z_stream));
+        //Members start with a gzip header, other checkpoints are raw deflate
+        //resuming mid stream
+        m_rawDeflate = !cp.member;
+        if( inflateInit2(m_inflate,cp.member ? 15+32 : -15) != Z_OK ) {
+            delete m_inflate;
+            m_inflate = 0;
+            return false;
+        }
+        if( cp.bits ) {
+            fseek64(m_fp,cp.in-1,SEEK_SET);
+            byte = getc(m_fp);
+            if( byte == EOF ) {
+                stopDecoder();
+                return false;
+            }
+            inflatePrime(m_inflate,cp.bits,byte >> (8-cp.bits));
+        }
+        if( !cp.member ) {
+            window = qUncompress(cp.window);
+            inflateSetDictionary(m_inflate,(const Bytef*)window.constData(),window.size());
+        }
+        return true;
+    }
+#endif
+#ifdef TDM_HAVE_ZSTD
+    if( m_format == Zstd ) {
+        m_zstd = ZSTD_createDStream();
+        if( m_zstd == 0 ) {
+            return false;
+        }
+        ZSTD_initDStream(m_zstd);
+        return true;
+    }
+#endif
+    return false;
+}
+
+void CaptureFile_Compressed::stopDecoder() const {
+#ifdef TDM_HAVE_ZLIB
+    if( m_inflate ) {
+        inflateEnd(m_inflate);
+        delete m_inflate;
+        m_inflate = 0;
+    }
+#endif
+#ifdef TDM_HAVE_ZSTD
+    if( m_zstd ) {
+        ZSTD_freeDStream(m_zstd);
+        m_zstd = 0;
+    }
+#endif
+}
+
+//Reads the next chunk of compressed data for the decoder
+bool CaptureFile_Compressed::fillInput() const {
+    if( m_input.size() != COMPRESSED_CHUNK ) {
+        m_input.resize(COMPRESSED_CHUNK);
+    }
+    fseek64(m_fp,m_decodeIn,SEEK_SET);
+    m_inSize = fread(m_input.data(),1,COMPRESSED_CHUNK,m_fp);
+    m_inPos = 0;
+    m_decodeIn = m_decodeIn + m_inSize;
+    return m_inSize > 0;
+}
+
+//Appends up to want more decoded bytes to m_span, returns how many
+size_t CaptureFile_Compressed::decodeMore(size_t want) const {
+    size_t offset = m_span.size();
+    size_t got = 0;
+    m_span.resize(offset+want);
+#ifdef TDM_HAVE_ZLIB
+    if( m_inflate ) {
+        int ret;
+        m_inflate->next_out = (Bytef*)m_span.data()+offset;
+        m_inflate->avail_out = want;
+        while( m_inflate->avail_out ) {
+            if( m_inflate->avail_in == 0 ) {
+                if( !fillInput() ) {
+                    break;
+                }
+                m_inflate->next_in = (Bytef*)m_input.data();
+                m_inflate->avail_in = m_inSize;
+            }
+            ret = inflate(m_inflate,Z_NO_FLUSH);
+            if( ret == Z_STREAM_END ) {
+                //Raw deflate stops short of the member's trailer
+                if( m_rawDeflate ) {
+                    m_decodeIn = m_decodeIn - m_inflate->avail_in + GZIP_TRAILER;
+                    m_inflate->avail_in = 0;
+                    m_rawDeflate = false;
+                }
+                //Another member may follow
+                if( m_inflate->avail_in == 0 && fillInput() ) {
+                    m_inflate->next_in = (Bytef*)m_input.data();
+                    m_inflate->avail_in = m_inSize;
+                }
+                if( m_inflate->avail_in == 0 || m_inflate->next_in[0] != 0x1F ||
+                    inflateReset2(m_inflate,15+32) != Z_OK ) {
+                    break;
+                }
+            }
+            else if( ret != Z_OK ) {
+                break;
+            }
+        }
+        got = want-m_inflate->avail_out;
+    }
+#endif
+#ifdef TDM_HAVE_ZSTD
+    if( m_zstd ) {
+        ZSTD_outBuffer out;
+        ZSTD_inBuffer in;
+        size_t ret;
+        out.dst = m_span.data()+offset;
+        out.size = want;
+        out.pos = 0;
+        //Runs on through following frames and skips skippable ones
+        while( out.pos < out.size ) {
+            if( m_inPos == m_inSize && !fillInput() ) {
+                break;
+            }
+            in.src = m_input.constData();
+            in.size = m_inSize;
+            in.pos = m_inPos;
+            ret = ZSTD_decompressStream(m_zstd,&out,&in);
+            m_inPos = in.pos;
+            if( ZSTD_isError(ret) ) {
+                break;
+            }
+        }
+        got = out.pos;
+    }
+#endif
+    m_span.resize(offset+got);
+    return got;
+}
+
+//Shows pos of the compressed bytes as indexed, false if cancelled
+bool CaptureFile_Compressed::indexProgress(QProgressDialog* dlg, quint64 pos) {
+    if( dlg == 0 ) {
+        return true;
+    }
+    dlg->setValue(m_fileSize ? (int)(qMin(pos,m_fileSize)*INDEX_PROGRESS_STEPS/m_fileSize) : 0);
+    return !dlg->wasCanceled();
+}
+
+bool CaptureFile_Compressed::buildGzipIndex(QProgressDialog* dlg) {
+#ifdef TDM_HAVE_ZLIB
+    unsigned char input[COMPRESSED_CHUNK];
+    unsigned char window[GZIP_WINDOW];
+    unsigned char history[GZIP_WINDOW];
+    Checkpoint cp;
+    z_stream strm;
+    quint64 totalIn = 0;
+    quint64 totalOut = 0;
+    quint64 last = 0;
+    size_t left, have;
+    int ret = Z_OK;
+
+    //The approach of zlib's examples/zran.c: inflate a block at a time
+    //and at block boundaries every GZIP_SPAN bytes remember where the
+    //block starts along with the 32 KB of output it may refer back to
+    memset(&strm,0,sizeof(strm));
+    if( inflateInit2(&strm,15+32) != Z_OK ) {
+        return false;
+    }
+    cp.in = 0;
+    cp.out = 0;
+    cp.bits = 0;
+    cp.member = true;
+    m_index.append(cp);
+
+    fseek64(m_fp,0,SEEK_SET);
+    strm.avail_out = 0;
+    for(;;) {
+        if( strm.avail_in == 0 ) {
+            if( !indexProgress(dlg,totalIn) ) {
+                inflateEnd(&strm);
+                m_index.clear();
+                return false;
+            }
+            strm.avail_in = fread(input,1,COMPRESSED_CHUNK,m_fp);
+            strm.next_in = input;
+            if( strm.avail_in == 0 ) {
+                break;
+            }
+        }
+        if( strm.avail_out == 0 ) {
+            strm.avail_out = GZIP_WINDOW;
+            strm.next_out = window;
+        }
+        totalIn += strm.avail_in;
+        totalOut += strm.avail_out;
+        ret = inflate(&strm,Z_BLOCK);
+        totalIn -= strm.avail_in;
+        totalOut -= strm.avail_out;
+        if( ret == Z_STREAM_END ) {
+            //Another member may follow (pigz, bgzip and cat all make those)
+            cp.in = totalIn;
+            cp.out = totalOut;
+            cp.bits = 0;
+            cp.member = true;
+            cp.window.clear();
+            if( strm.avail_in == 0 ) {
+                strm.avail_in = fread(input,1,COMPRESSED_CHUNK,m_fp);
+                strm.next_in = input;
+            }
+            if( strm.avail_in == 0 || strm.next_in[0] != 0x1F ) {
+                break;
+            }
+            m_index.append(cp);
+            last = totalOut;
+            inflateReset(&strm);
+            continue;
+        }
+        if( ret != Z_OK && ret != Z_BUF_ERROR ) {
+            //Keep what decoded cleanly
+            break;
+        }
+        if( (strm.data_type & 128) && !(strm.data_type & 64) && totalOut-last >= GZIP_SPAN ) {
+            //Unroll the circular window so the oldest byte comes first
+            left = strm.avail_out;
+            have = qMin(totalOut,(quint64)GZIP_WINDOW);
+            if( left ) {
+                memcpy(history,window+GZIP_WINDOW-left,left);
+            }
+            memcpy(history+left,window,GZIP_WINDOW-left);
+            cp.in = totalIn;
+            cp.out = totalOut;
+            cp.bits = strm.data_type & 7;
+            cp.member = false;
+            cp.window = qCompress(history+GZIP_WINDOW-have,have);
+            m_index.append(cp);
+            last = totalOut;
+        }
+    }
+    inflateEnd(&strm);
+
+    //End marker
+    cp.in = totalIn;
+    cp.out = totalOut;
+    cp.bits = 0;
+    cp.member = true;
+    cp.window.clear();
+    if( m_index.last().out == totalOut ) {
+        m_index.last() = cp;
+    }
+    else {
+        m_index.append(cp);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+//Seekable zstd files end with a skippable frame holding the compressed
+//and decompressed size of every frame, so no scan is needed
+bool CaptureFile_Compressed::readSeekTable() {
+#ifdef TDM_HAVE_ZSTD
+    unsigned char footer[ZSTD_SEEK_FOOTER];
+    unsigned char* entry;
+    QByteArray table;
+    quint32 frames, i;
+    size_t entrySize;
+    Checkpoint cp;
+
+    if( m_fileSize < ZSTD_SEEK_FOOTER+8 ) {
+        return false;
+    }
+    fseek64(m_fp,m_fileSize-ZSTD_SEEK_FOOTER,SEEK_SET);
+    if( fread(footer,1,ZSTD_SEEK_FOOTER,m_fp) != ZSTD_SEEK_FOOTER ||
+        readLE32(footer+5) != ZSTD_SEEKABLE_MAGIC ) {
+        return false;
+    }
+    frames = readLE32(footer);
+    entrySize = (footer[4] & 0x80) ? 12 : 8;   //Optional checksums
+    if( (quint64)frames*entrySize+ZSTD_SEEK_FOOTER+8 > m_fileSize ) {
+        return false;
+    }
+    table.resize(frames*entrySize);
+    fseek64(m_fp,m_fileSize-ZSTD_SEEK_FOOTER-table.size(),SEEK_SET);
+    if( fread(table.data(),1,table.size(),m_fp) != (size_t)table.size() ) {
+        return false;
+    }
+
+    cp.in = 0;
+    cp.out = 0;
+    cp.bits = 0;
+    cp.member = true;
+    for( i=0; i<frames; i++ ) {
+        m_index.append(cp);
+        entry = (unsigned char*)table.data()+i*entrySize;
+        cp.in = cp.in + readLE32(entry);
+        cp.out = cp.out + readLE32(entry+4);
+    }
+    m_index.append(cp);
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef TDM_HAVE_ZSTD
+//Size of the frame header (magic included) described by its descriptor byte
+static size_t zstdHeaderSize(unsigned char descriptor) {
+    static const size_t dictIdSize[4] = { 0, 1, 2, 4 };
+    static const size_t contentSizeSize[4] = { 0, 2, 4, 8 };
+    bool singleSegment = (descriptor >> 5) & 1;
+    size_t size = 5 + (singleSegment ? 0 : 1) + dictIdSize[descriptor & 3] + contentSizeSize[descriptor >> 6];
+    if( singleSegment && (descriptor >> 6) == 0 ) {
+        size = size + 1;
+    }
+    return size;
+}
+#endif
+
+//Plain zstd files are indexed by walking the frame and block headers.
+//Random access is per frame, so going back within a file written as a
+//single frame decodes it again from the start.
+bool CaptureFile_Compressed::buildZstdIndex(QProgressDialog* dlg) {
+#ifdef TDM_HAVE_ZSTD
+    unsigned char header[ZSTD_HEADER_MAX];
+    unsigned char block[3];
+    unsigned char chunk[COMPRESSED_CHUNK];
+    Checkpoint cp;
+    quint64 pos = 0;
+    quint64 out = 0;
+    quint64 start, left;
+    unsigned long long size;
+    size_t got;
+    quint32 blockHeader, blockSize;
+    bool complete;
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer sink;
+
+    cp.bits = 0;
+    cp.member = true;
+    while( pos+8 <= m_fileSize ) {
+        if( !indexProgress(dlg,pos) ) {
+            m_index.clear();
+            return false;
+        }
+        fseek64(m_fp,pos,SEEK_SET);
+        got = fread(header,1,sizeof(header),m_fp);
+        if( (readLE32(header) & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC ) {
+            pos = pos + 8 + readLE32(header+4);
+            continue;
+        }
+        if( readLE32(header) != ZSTD_FRAME_MAGIC ) {
+            break;
+        }
+        start = pos;
+        pos = pos + zstdHeaderSize(header[4]);
+        complete = false;
+        while( fseek64(m_fp,pos,SEEK_SET) == 0 && fread(block,1,3,m_fp) == 3 ) {
+            blockHeader = block[0] | (block[1] << 8) | (block[2] << 16);
+            blockSize = blockHeader >> 3;
+            //RLE blocks store a single byte
+            pos = pos + 3 + (((blockHeader >> 1) & 3) == 1 ? 1 : blockSize);
+            if( blockHeader & 1 ) {
+                complete = true;
+                break;
+            }
+        }
+        if( (header[4] >> 2) & 1 ) {
+            pos = pos + 4;      //Content checksum
+        }
+        if( !complete || pos > m_fileSize ) {
+            //Truncated, still being written
+            pos = start;
+            break;
+        }
+
+        size = ZSTD_getFrameContentSize(header,got);
+        if( size == ZSTD_CONTENTSIZE_ERROR ) {
+            break;
+        }
+        if( size == ZSTD_CONTENTSIZE_UNKNOWN ) {
+            //Only decompressing tells, a chunk at a time since frames can
+            //be any size
+            stream = ZSTD_createDStream();
+            ZSTD_initDStream(stream);
+            QByteArray scratch(ZSTD_DStreamOutSize(),0);
+            fseek64(m_fp,start,SEEK_SET);
+            left = pos-start;
+            size = 0;
+            got = 1;
+            while( left && !ZSTD_isError(got) && got != 0 ) {
+                if( !indexProgress(dlg,pos-left) ) {
+                    ZSTD_freeDStream(stream);
+                    m_index.clear();
+                    return false;
+                }
+                in.size = fread(chunk,1,qMin(left,(quint64)COMPRESSED_CHUNK),m_fp);
+                in.src = chunk;
+                in.pos = 0;
+                if( in.size == 0 ) {
+                    break;
+                }
+                left = left - in.size;
+                do {
+                    sink.dst = scratch.data();
+                    sink.size = scratch.size();
+                    sink.pos = 0;
+                    got = ZSTD_decompressStream(stream,&sink,&in);
+                    size = size + sink.pos;
+                } while( !ZSTD_isError(got) && got != 0 && (in.pos < in.size || sink.pos == sink.size) );
+            }
+            ZSTD_freeDStream(stream);
+            if( got != 0 ) {
+                pos = start;
+                break;
+            }
+        }
+        cp.in = start;
+        cp.out = out;
+        m_index.append(cp);
+        out = out + size;
+    }
+    //End marker
+    cp.in = pos;
+    cp.out = out;
+    m_index.append(cp);
+    return true;
+#else
+    return false;
+#endif
+}
+
+QString CaptureFile_Compressed::indexPath() {
+    return m_path + ".tdmidx";
+}
+
+bool CaptureFile_Compressed::loadIndex() {
+    QFile file(indexPath());
+    QFileInfo info(m_path);
+    quint32 magic, version, format, count, i;
+    quint64 fileSize;
+    qint64 modified;
+    qint32 bits;
+    Checkpoint cp;
+
+    if( !file.open(QFile::ReadOnly) ) {
+        return false;
+    }
+    QDataStream stream(&file);
+    stream >> magic >> version >> format >> fileSize >> modified >> count;
+    //Ignore indexes of a file that has since been replaced
+    if( stream.status() != QDataStream::Ok || magic != INDEX_MAGIC || version != INDEX_VERSION ||
+        format != (quint32)m_format || fileSize != m_fileSize ||
+        modified != info.lastModified().toMSecsSinceEpoch() ) {
+        return false;
+    }
+    for( i=0; i<count; i++ ) {
+        stream >> cp.in >> cp.out >> bits >> cp.member >> cp.window;
+        cp.bits = bits;
+        m_index.append(cp);
+    }
+    if( stream.status() != QDataStream::Ok || m_index.size() < 2 ) {
+        m_index.clear();
+        return false;
+    }
+    return true;
+}
+
+void CaptureFile_Compressed::saveIndex() {
+    QFile file(indexPath());
+    QFileInfo info(m_path);
+    int i;
+
+    //Read only directories just mean indexing again next time
+    if( !file.open(QFile::WriteOnly) ) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << (quint32)INDEX_MAGIC << (quint32)INDEX_VERSION << (quint32)m_format
+           << m_fileSize << (qint64)info.lastModified().toMSecsSinceEpoch() << (quint32)m_index.size();
+    for( i=0; i<m_index.size(); i++ ) {
+        stream << m_index[i].in << m_index[i].out << (qint32)m_index[i].bits
+               << m_index[i].member << m_index[i].window;
+    }
+}
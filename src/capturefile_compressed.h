@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CAPTUREFILE_COMPRESSED_H
+#define CAPTUREFILE_COMPRESSED_H
+
+#include<stdio.h>
+#include<QMutex>
+#include<QByteArray>
+#include<QVector>
+#include<QProgressDialog>
+#include"capturefile.h"
+
+//Reads gzip and zstd compressed captures without decompressing them to
+//disk.  A checkpoint index (built on first open and kept next to the file
+//as <file>.tdmidx) lets a read start decompressing close to the data it
+//wants.  Reads further on continue with the same decoder.  Building the
+//index decompresses the whole file, with dlg it shows progress and can be
+//cancelled, leaving the file closed.
+class CaptureFile_Compressed: public CaptureFile
+{
+public:
+    enum Format { None, Gzip, Zstd };
+    CaptureFile_Compressed(QString path, bool bytePerBit=false, QProgressDialog* dlg=0);
+    virtual ~CaptureFile_Compressed();
+    //Format of the file at path going by its first bytes.  None if it is
+    //not compressed or tdm_view was built without support for the format.
+    static Format detect(QString path);
+    bool isOpen();
+    virtual quint64 sizebit();
+    virtual void prefetch(quint64 offset, quint64 length);
+
+protected:
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
+    virtual size_t readraw(quint64 pos, size_t len, unsigned char* buf) const;
+
+private:
+    struct Checkpoint {
+        quint64 in;         //Compressed byte offset
+        quint64 out;        //Uncompressed byte offset
+        int bits;           //Gzip: bits of the byte before in that are still unused
+        bool member;        //Starts a gzip member or zstd frame, needs no window
+        QByteArray window;  //Gzip: up to 32 KB of output before out (qCompress()ed)
+    };
+    QString indexPath();
+    bool loadIndex();
+    void saveIndex();
+    bool buildGzipIndex(QProgressDialog* dlg);
+    bool buildZstdIndex(QProgressDialog* dlg);
+    bool indexProgress(QProgressDialog* dlg, quint64 pos);
+    bool readSeekTable();
+    bool decode(quint64 pos, quint64 end) const;
+    bool startDecoder(int point) const;
+    void stopDecoder() const;
+    bool fillInput() const;
+    size_t decodeMore(size_t want) const;
+
+    QString m_path;
+    FILE* m_fp;
+    mutable QMutex m_ioMutex;   //Guards m_fp, the decoder and the decoded span
+    Format m_format;
+    QVector<Checkpoint> m_index;    //Ends with a checkpoint at the end of the data
+    quint64 m_dataSize;             //Uncompressed bytes
+    quint64 m_fileSize;
+    bool m_bytePerBit;
+    //Most recently decoded data, up to where the decoder is
+    mutable QByteArray m_span;
+    mutable quint64 m_spanStart;
+    //The decoder (one of them, or neither until the first read) and the
+    //compressed data it is working through
+    mutable struct z_stream_s* m_inflate;
+    mutable struct ZSTD_DCtx_s* m_zstd;
+    mutable QByteArray m_input;
+    mutable size_t m_inPos;
+    mutable size_t m_inSize;
+    mutable quint64 m_decodeIn;     //Compressed offset after m_input
+    mutable bool m_rawDeflate;      //Gzip: started inside a member, no header or trailer
+};
+
+#endif // CAPTUREFILE_COMPRESSED_H
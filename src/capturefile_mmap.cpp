@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "capturefile_mmap.h"
+#include "bitkernels.h"
+#include <string.h>
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <QMutexLocker>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+CaptureFile_MMap::CaptureFile_MMap(QString path, bool bytePerBit): CaptureFile(path)
+{
+    m_data = 0;
+    m_dataSize = 0;
+    m_fileSize = 0;
+    m_bytePerBit = bytePerBit;
+    m_scans = 0;
+
+    m_file.setFileName(path);
+    if( m_file.open(QFile::ReadOnly) && m_file.size() > 0 ) {
+        m_data = m_file.map(0,m_file.size());
+        if( m_data ) {
+            m_dataSize = m_file.size();
+            if( m_bytePerBit ) {
+                m_fileSize = m_dataSize;
+            }
+            else {
+                m_fileSize = m_dataSize*8;
+            }
+        }
+    }
+}
+
+CaptureFile_MMap::~CaptureFile_MMap() {
+    if( m_data ) {
+        m_file.unmap(m_data);
+    }
+    m_file.close();
+}
+
+bool CaptureFile_MMap::isMapped() {
+    return m_data != 0;
+}
+
+quint64 CaptureFile_MMap::sizebit() {
+    QReadLocker lock(&m_mapLock);
+    return m_fileSize;
+}
+
+size_t CaptureFile_MMap::readbits(quint64 offset, size_t count, quint64* out) const {
+    QReadLocker lock(&m_mapLock);
+    size_t valid = 0;
+    size_t words;
+    if( offset < m_fileSize ) {
+        valid = count;
+        if( m_fileSize-offset < count ) {
+            valid = m_fileSize-offset;
+        }
+        if( m_bytePerBit ) {
+            BitKernels::packBytes(m_data+offset,valid,out,false);
+        }
+        else {
+            BitKernels::unpackBits(m_data+offset/8,offset%8,valid,out,false);
+        }
+    }
+    words = BitKernels::wordCount(valid);
+    memset(out+words,0,(BitKernels::wordCount(count)-words)*sizeof(quint64));
+    return valid;
+}
+
+void CaptureFile_MMap::prefetch(quint64 offset, quint64 length) {
+#ifdef Q_OS_UNIX
+    quint64 start, end;
+    quint64 pageSize = sysconf(_SC_PAGESIZE);
+    QReadLocker lock(&m_mapLock);
+    if( m_data == 0 || offset >= m_fileSize ) {
+        return;
+    }
+    if( length > m_fileSize-offset ) {
+        length = m_fileSize-offset;
+    }
+    if( m_bytePerBit ) {
+        start = offset;
+        end = offset+length;
+    }
+    else {
+        start = offset/8;
+        end = (offset+length+7)/8;
+    }
+    //madvise() requires a page aligned address
+    start = start - (start % pageSize);
+    madvise(m_data+start,end-start,MADV_WILLNEED);
+#else
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+#endif
+}
+
+bool CaptureFile_MMap::refresh() {
+    qint64 size = m_file.size();
+    uchar* data;
+    if( m_data == 0 || size <= (qint64)m_dataSize ) {
+        return false;
+    }
+    //Map the grown file before dropping the old mapping
+    data = m_file.map(0,size);
+    if( data == 0 ) {
+        return false;
+    }
+    QWriteLocker lock(&m_mapLock);
+    m_file.unmap(m_data);
+    m_data = data;
+    m_dataSize = size;
+    if( m_bytePerBit ) {
+        m_fileSize = m_dataSize;
+    }
+    else {
+        m_fileSize = m_dataSize*8;
+    }
+    return true;
+}
+
+void CaptureFile_MMap::beginscan(bool direct) {
+    //The mapping is the page cache, there is nothing to read around
+    Q_UNUSED(direct);
+    QMutexLocker lock(&m_scanMutex);
+#ifdef Q_OS_UNIX
+    if( m_scans == 0 ) {
+        advise(MADV_SEQUENTIAL);
+    }
+#endif
+    m_scans++;
+}
+
+void CaptureFile_MMap::endscan() {
+    QMutexLocker lock(&m_scanMutex);
+    if( m_scans > 0 && --m_scans > 0 ) {
+        return;
+    }
+#ifdef Q_OS_UNIX
+    advise(MADV_NORMAL);
+#endif
+}
+
+void CaptureFile_MMap::release(quint64 offset, quint64 length) {
+#ifdef Q_OS_UNIX
+    quint64 start, end;
+    quint64 pageSize = sysconf(_SC_PAGESIZE);
+    QReadLocker lock(&m_mapLock);
+    if( m_data == 0 || offset >= m_fileSize ) {
+        return;
+    }
+    if( length > m_fileSize-offset ) {
+        length = m_fileSize-offset;
+    }
+    if( m_bytePerBit ) {
+        start = offset;
+        end = offset+length;
+    }
+    else {
+        start = (offset+7)/8;
+        end = (offset+length)/8;
+    }
+    //Only whole pages inside the range
+    start = (start+pageSize-1)/pageSize*pageSize;
+    end = end/pageSize*pageSize;
+    if( end <= start ) {
+        return;
+    }
+    //Unmaps the pages from this process, then drops them from the page cache
+    madvise(m_data+start,end-start,MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(m_file.handle(),start,end-start,POSIX_FADV_DONTNEED);
+#endif
+#else
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+#endif
+}
+
+void CaptureFile_MMap::advise(int advice) {
+#ifdef Q_OS_UNIX
+    QReadLocker lock(&m_mapLock);
+    if( m_data ) {
+        madvise(m_data,m_dataSize,advice);
+    }
+#else
+    Q_UNUSED(advice);
+#endif
+}
@@ -23,55 +23,44 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#include "capturefile_byteperbit.h"
+#ifndef CAPTUREFILE_MMAP_H
+#define CAPTUREFILE_MMAP_H
 
-CaptureFile_BytePerBit::CaptureFile_BytePerBit(QString path, bool invert): CaptureFile(path)
+#include<QFile>
+#include<QReadWriteLock>
+#include<QMutex>
+#include"capturefile.h"
 
+//Maps the entire capture into memory so that bits are read directly
+//from the page cache rather than through stdio.  Handles both the bit
+//per bit and byte per bit file layouts.
+class CaptureFile_MMap: public CaptureFile
 {
-    m_fp = fopen(path.toStdString().c_str(),"rb");
-    fseek(m_fp,0,SEEK_END);
-    m_fileSize = ftell(m_fp);
-    fseek(m_fp,0,SEEK_SET);
-    m_invert = invert;
-}
+public:
+    CaptureFile_MMap(QString path, bool bytePerBit=false);
+    virtual ~CaptureFile_MMap();
+    bool isMapped();
+    virtual quint64 sizebit();
+    virtual void prefetch(quint64 offset, quint64 length);
+    virtual bool refresh();
+    virtual void beginscan(bool direct=false);
+    virtual void endscan();
+    virtual void release(quint64 offset, quint64 length);
 
-CaptureFile_BytePerBit::~CaptureFile_BytePerBit() {
-    fclose(m_fp);
-}
+protected:
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
 
-size_t CaptureFile_BytePerBit::tellbit() {
-    return ftell(m_fp);
-}
-void CaptureFile_BytePerBit::seekbit(size_t offset) {
-    fseek(m_fp,offset,SEEK_SET);
-}
+private:
+    void advise(int advice);
 
-size_t CaptureFile_BytePerBit::sizebit() {
-    return m_fileSize;
-}
+    QFile m_file;
+    mutable QReadWriteLock m_mapLock;  //Readers share the mapping, refresh() replaces it
+    uchar* m_data;
+    quint64 m_dataSize;
+    quint64 m_fileSize;
+    bool m_bytePerBit;
+    QMutex m_scanMutex;
+    int m_scans;            //Scans in progress
+};
 
-QBitArray* CaptureFile_BytePerBit::readbit(size_t readlen) {
-    char buf[1024];
-    size_t block_size;
-    size_t bits_size = 0;
-    size_t read_size;
-    size_t i;
-    QBitArray *bits = new QBitArray(readlen);
-    while( bits_size < readlen ) {
-        if( readlen-bits_size < 1024 ) {
-            block_size = readlen-bits_size;
-        } else {
-            block_size = 1024;
-        }
-        memset(buf,0,1024);
-        read_size = fread(buf,1,block_size,m_fp);
-        for( i=0; i<read_size; i++ ) {
-            if( (buf[i] && !m_invert) ||
-                (!buf[i] && m_invert) ) {
-                bits->setBit(bits_size+i,true);
-            }
-        }
-        bits_size = bits_size + read_size;
-    }
-    return bits;
-}
+#endif // CAPTUREFILE_MMAP_H
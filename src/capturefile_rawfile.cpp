@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "capturefile_rawfile.h"
+#include "bitkernels.h"
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+//Whether a read can go through the O_DIRECT descriptor
+static bool isAligned(quint64 pos, size_t len, const unsigned char* buf) {
+    return pos%RAWFILE_ALIGN == 0 && len%RAWFILE_ALIGN == 0 && (quintptr)buf%RAWFILE_ALIGN == 0;
+}
+
+CaptureFile_RawFile::CaptureFile_RawFile(QString path, bool bytePerBit): CaptureFile(path)
+{
+    m_path = path;
+    m_bytePerBit = bytePerBit;
+    m_file.open(path);
+    m_reader = BlockReader::create(&m_file);
+    m_directReader = 0;
+    m_scans = 0;
+    m_fileSize = m_bytePerBit ? m_file.size() : m_file.size()*8;
+}
+
+CaptureFile_RawFile::~CaptureFile_RawFile() {
+    endscan();
+    delete m_reader;
+}
+
+quint64 CaptureFile_RawFile::sizebit() {
+    return fileSize();
+}
+
+void CaptureFile_RawFile::prefetch(quint64 offset, quint64 length) {
+    quint64 size = fileSize();
+    if( offset >= size ) {
+        return;
+    }
+    length = qMin(length,size-offset);
+    if( m_bytePerBit ) {
+        prefetchbytes(offset,length);
+    }
+    else {
+        prefetchbytes(offset/8,(offset%8+length+7)/8);
+    }
+}
+
+bool CaptureFile_RawFile::refresh() {
+    QMutexLocker lock(&m_sizeMutex);
+    quint64 size = m_bytePerBit ? m_file.size() : m_file.size()*8;
+    if( size <= m_fileSize ) {
+        return false;
+    }
+    //The block holding the old end of the file was cached short
+    cache()->invalidate((m_bytePerBit ? m_fileSize : m_fileSize/8)/cache()->blockSize());
+    m_fileSize = size;
+    return true;
+}
+
+void CaptureFile_RawFile::beginscan(bool direct) {
+    QWriteLocker lock(&m_scanLock);
+    if( m_scans++ == 0 ) {
+        m_file.adviseSequential(true);
+    }
+    if( direct && !m_direct.isOpen() && m_direct.open(m_path,true) ) {
+        m_directReader = BlockReader::create(&m_direct);
+    }
+}
+
+void CaptureFile_RawFile::endscan() {
+    QWriteLocker lock(&m_scanLock);
+    if( m_scans > 0 && --m_scans > 0 ) {
+        return;
+    }
+    m_file.adviseSequential(false);
+    delete m_directReader;
+    m_directReader = 0;
+    m_direct.close();
+}
+
+void CaptureFile_RawFile::release(quint64 offset, quint64 length) {
+    quint64 size = fileSize();
+    quint64 start, end;
+    if( offset >= size ) {
+        return;
+    }
+    length = qMin(length,size-offset);
+    if( m_bytePerBit ) {
+        start = offset;
+        end = offset+length;
+    }
+    else {
+        //Only bytes entirely inside the range, neighbours may still be wanted
+        start = (offset+7)/8;
+        end = (offset+length)/8;
+    }
+    if( end <= start ) {
+        return;
+    }
+    releasebytes(start,end-start);
+    m_file.drop(start,end-start);
+}
+
+size_t CaptureFile_RawFile::readbits(quint64 offset, size_t count, quint64* out) const {
+    return extractraw(offset,count,out,m_bytePerBit,fileSize());
+}
+
+size_t CaptureFile_RawFile::readraw(quint64 pos, size_t len, unsigned char* buf) const {
+    //pread() style, readers only share m_scanLock
+    QReadLocker lock(&m_scanLock);
+    if( m_direct.isOpen() && isAligned(pos,len,buf) ) {
+        return m_direct.read(pos,len,buf);
+    }
+    return m_file.read(pos,len,buf);
+}
+
+void CaptureFile_RawFile::readblocks(BlockReader::Request* requests, size_t count) const {
+    QReadLocker lock(&m_scanLock);
+    size_t i;
+    if( m_directReader ) {
+        for( i=0; i<count && isAligned(requests[i].pos,requests[i].len,requests[i].buf); i++ ) { }
+        if( i == count ) {
+            m_directReader->read(requests,count);
+            return;
+        }
+    }
+    m_reader->read(requests,count);
+}
+
+quint64 CaptureFile_RawFile::fileSize() const {
+    QMutexLocker lock(&m_sizeMutex);
+    return m_fileSize;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CAPTUREFILE_RAWFILE_H
+#define CAPTUREFILE_RAWFILE_H
+
+#include<QMutex>
+#include<QReadWriteLock>
+#include"capturefile.h"
+#include"rawfile.h"
+
+//Reads the capture with pread() (see RawFile) through the block cache.
+//Handles both the bit per bit and byte per bit file layouts.
+class CaptureFile_RawFile: public CaptureFile
+{
+public:
+    CaptureFile_RawFile(QString path, bool bytePerBit=false);
+    virtual ~CaptureFile_RawFile();
+    virtual quint64 sizebit();
+    virtual void prefetch(quint64 offset, quint64 length);
+    virtual bool refresh();
+    virtual void beginscan(bool direct=false);
+    virtual void endscan();
+    virtual void release(quint64 offset, quint64 length);
+
+protected:
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
+    virtual size_t readraw(quint64 pos, size_t len, unsigned char* buf) const;
+    virtual void readblocks(BlockReader::Request* requests, size_t count) const;
+
+private:
+    quint64 fileSize() const;
+
+    QString m_path;
+    bool m_bytePerBit;
+    RawFile m_file;
+    BlockReader* m_reader;
+    mutable QReadWriteLock m_scanLock;  //endscan() closes m_direct under readers
+    RawFile m_direct;                   //Uncached descriptor while scanning
+    BlockReader* m_directReader;
+    int m_scans;                        //Scans in progress, under m_scanLock
+    mutable QMutex m_sizeMutex; //refresh() may grow the file under readers
+    quint64 m_fileSize;
+};
+
+#endif // CAPTUREFILE_RAWFILE_H
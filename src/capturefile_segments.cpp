@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "capturefile_segments.h"
+#include "bitkernels.h"
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QMutexLocker>
+#include <algorithm>
+
+CaptureFile_Segments::CaptureFile_Segments(QString pattern, bool bytePerBit): CaptureFile(pattern)
+{
+    m_pattern = pattern;
+    m_starts.append(0);
+    m_bytePerBit = bytePerBit;
+    addSegments(expand(pattern));
+    m_changed = m_starts.last();
+    m_sweep = 0;
+}
+
+CaptureFile_Segments::CaptureFile_Segments(QStringList paths, bool bytePerBit):
+    CaptureFile(paths.isEmpty() ? QString() : paths.first())
+{
+    m_starts.append(0);
+    m_bytePerBit = bytePerBit;
+    addSegments(paths);
+    m_changed = m_starts.last();
+    m_sweep = 0;
+}
+
+CaptureFile_Segments::~CaptureFile_Segments() {
+}
+
+bool CaptureFile_Segments::isPattern(QString path) {
+    return (path.contains('*') || path.contains('?') || path.contains('[')) && !QFileInfo(path).exists();
+}
+
+QStringList CaptureFile_Segments::expand(QString pattern) {
+    QFileInfo info(pattern);
+    QDir dir = info.dir();
+    QStringList names = dir.entryList(QStringList(info.fileName()),QDir::Files,QDir::Name);
+    QStringList paths;
+    int i;
+    for( i=0; i<names.size(); i++ ) {
+        paths.append(dir.filePath(names[i]));
+    }
+    return paths;
+}
+
+bool CaptureFile_Segments::isOpen() {
+    return !m_paths.isEmpty();
+}
+
+QStringList CaptureFile_Segments::segments() {
+    QMutexLocker lock(&m_mutex);
+    return m_paths;
+}
+
+quint64 CaptureFile_Segments::sizebit() {
+    QMutexLocker lock(&m_mutex);
+    return m_bytePerBit ? m_starts.last() : m_starts.last()*8;
+}
+
+void CaptureFile_Segments::prefetch(quint64 offset, quint64 length) {
+    quint64 size;
+    m_mutex.lock();
+    size = m_starts.last();
+    m_mutex.unlock();
+    if( !m_bytePerBit ) {
+        length = (offset%8+length+7)/8;
+        offset = offset/8;
+    }
+    if( offset >= size ) {
+        return;
+    }
+    length = qMin(length,size-offset);
+    prefetchbytes(offset,length);
+}
+
+bool CaptureFile_Segments::refresh() {
+    QMutexLocker lock(&m_mutex);
+    QVector<quint64> old = m_starts;
+    quint64 total = old.last();
+    int count = m_paths.size();
+    int tail = qMax(count-SEGMENTS_REFRESH_TAIL,0);
+    QHash<int,quint64> grown;
+    QList<int> check;
+    QStringList found;
+    quint64 size;
+    int i, first;
+
+    //Recorders can still finish a segment after starting the next one.
+    //The newest segments are sized every time, the older ones a few at a
+    //time in turn, so a poll costs the same however many segments there are.
+    for( i=tail; i<count; i++ ) {
+        check.append(i);
+    }
+    for( i=0; i<SEGMENTS_REFRESH_SWEEP && i<tail; i++ ) {
+        if( m_sweep >= tail ) {
+            m_sweep = 0;
+        }
+        check.append(m_sweep++);
+    }
+    first = count;
+    for( i=0; i<check.size(); i++ ) {
+        size = QFileInfo(m_paths[check[i]]).size();
+        if( size > old[check[i]+1]-old[check[i]] ) {
+            grown.insert(check[i],size);
+            first = qMin(first,check[i]);
+        }
+    }
+    //Growing moves all segments after it
+    for( i=first; i<count; i++ ) {
+        size = grown.contains(i) ? grown.value(i) : old[i+1]-old[i];
+        m_starts[i+1] = m_starts[i]+size;
+    }
+    m_changed = first < count-1 ? old[first+1] : total;
+    if( m_pattern.length() ) {
+        found = expand(m_pattern);
+        if( found.size() > m_paths.size() && found.mid(0,m_paths.size()) == m_paths ) {
+            addSegments(found.mid(m_paths.size()));
+        }
+    }
+    if( m_starts.last() == total ) {
+        return false;
+    }
+    if( m_changed < total ) {
+        //Also keeps reads already past the segment table from putting
+        //back blocks with the old offsets
+        cache()->clear();
+    }
+    else {
+        //The block holding the old end was cached short
+        cache()->invalidate(total/cache()->blockSize());
+    }
+    return true;
+}
+
+quint64 CaptureFile_Segments::changedbit() {
+    QMutexLocker lock(&m_mutex);
+    return m_bytePerBit ? m_changed : m_changed*8;
+}
+
+size_t CaptureFile_Segments::readbits(quint64 offset, size_t count, quint64* out) const {
+    quint64 size;
+    m_mutex.lock();
+    size = m_bytePerBit ? m_starts.last() : m_starts.last()*8;
+    m_mutex.unlock();
+    return extractraw(offset,count,out,m_bytePerBit,size);
+}
+
+size_t CaptureFile_Segments::readraw(quint64 pos, size_t len, unsigned char* buf) const {
+    QSharedPointer<RawFile> file;
+    quint64 start, end;
+    size_t done = 0;
+    size_t n, got;
+    int segment;
+
+    //Reads crossing a segment boundary continue into the next file, so
+    //frames spanning two segments come out whole
+    while( done < len ) {
+        //Only finding the segment takes the lock, the read itself doesn't
+        m_mutex.lock();
+        if( pos+done >= m_starts.last() ) {
+            m_mutex.unlock();
+            break;
+        }
+        segment = std::upper_bound(m_starts.constBegin(),m_starts.constEnd(),pos+done)-m_starts.constBegin()-1;
+        start = m_starts[segment];
+        end = m_starts[segment+1];
+        file = segmentFile(segment);
+        m_mutex.unlock();
+        if( file.isNull() ) {
+            break;
+        }
+        n = qMin((quint64)(len-done),end-(pos+done));
+        got = file->read(pos+done-start,n,buf+done);
+        done = done + got;
+        if( got < n ) {
+            break;
+        }
+    }
+    return done;
+}
+
+void CaptureFile_Segments::addSegments(QStringList paths) {
+    int i;
+    for( i=0; i<paths.size(); i++ ) {
+        m_paths.append(paths[i]);
+        m_files.append(QSharedPointer<RawFile>());
+        m_starts.append(m_starts.last()+QFileInfo(paths[i]).size());
+    }
+}
+
+QSharedPointer<RawFile> CaptureFile_Segments::segmentFile(int segment) const {
+    QSharedPointer<RawFile> file = m_files[segment];
+    if( !file.isNull() ) {
+        m_open.removeOne(segment);
+        m_open.prepend(segment);
+        return file;
+    }
+    if( m_open.size() >= SEGMENTS_OPEN_LIMIT ) {
+        m_files[m_open.takeLast()].clear();
+    }
+    file = QSharedPointer<RawFile>(new RawFile());
+    if( !file->open(m_paths[segment]) ) {
+        return QSharedPointer<RawFile>();
+    }
+    m_files[segment] = file;
+    m_open.prepend(segment);
+    return file;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CAPTUREFILE_SEGMENTS_H
+#define CAPTUREFILE_SEGMENTS_H
+
+#include<QMutex>
+#include<QVector>
+#include<QList>
+#include<QStringList>
+#include<QSharedPointer>
+#include"capturefile.h"
+#include"rawfile.h"
+
+//Most segment files kept open at once, the least recently read is closed
+//to make room for another
+#define SEGMENTS_OPEN_LIMIT 64
+
+//refresh() sizes the last SEGMENTS_REFRESH_TAIL segments every time and
+//SEGMENTS_REFRESH_SWEEP of the older ones in turn
+#define SEGMENTS_REFRESH_TAIL 4
+#define SEGMENTS_REFRESH_SWEEP 16
+
+//Presents an ordered set of segment files (e.g. capture_0000.bin,
+//capture_0001.bin, ...) as one continuous capture.  A table of where each
+//segment starts finds the one holding any offset with a binary search and
+//files are only opened when read.  Reads go to the segments with pread(),
+//so any number of threads can read at once.
+class CaptureFile_Segments: public CaptureFile
+{
+public:
+    //Every file matching a wildcard pattern (in its last path component),
+    //in name order.  Following picks up segments that appear later.
+    CaptureFile_Segments(QString pattern, bool bytePerBit=false);
+    CaptureFile_Segments(QStringList paths, bool bytePerBit=false);
+    virtual ~CaptureFile_Segments();
+    //True for paths with wildcards that do not name an existing file
+    static bool isPattern(QString path);
+    static QStringList expand(QString pattern);
+    bool isOpen();
+    QStringList segments();
+    virtual quint64 sizebit();
+    virtual void prefetch(quint64 offset, quint64 length);
+    virtual bool refresh();
+    virtual quint64 changedbit();
+
+protected:
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
+    virtual size_t readraw(quint64 pos, size_t len, unsigned char* buf) const;
+
+private:
+    void addSegments(QStringList paths);
+    QSharedPointer<RawFile> segmentFile(int segment) const;
+
+    QString m_pattern;
+    QStringList m_paths;
+    QVector<quint64> m_starts;      //Byte offset of each segment, then the total size
+    quint64 m_changed;              //First byte that moved at the last refresh()
+    int m_sweep;                    //Next older segment refresh() sizes
+    //Null while a segment is closed.  A segment closed to make room stays
+    //open until the reads still using it are done.
+    mutable QVector< QSharedPointer<RawFile> > m_files;
+    mutable QList<int> m_open;      //Open segments, most recently read first
+    mutable QMutex m_mutex;         //Guards the tables above, not the reads
+    bool m_bytePerBit;
+};
+
+#endif // CAPTUREFILE_SEGMENTS_H
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "capturefile_stream.h"
+#include "bitkernels.h"
+#include <QThread>
+#include <QMutexLocker>
+#include <QVector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <poll.h>
+#else
+#include <io.h>
+#endif
+
+//Bytes taken from the input per read and how often the reader checks
+//whether it should stop while no data arrives
+#define STREAM_CHUNK (64*1024)
+#define STREAM_POLL_MS 100
+
+class StreamReader : public QThread
+{
+public:
+    StreamReader(CaptureFile_Stream* stream) : m_stream(stream) {}
+protected:
+    virtual void run() { m_stream->receive(); }
+private:
+    CaptureFile_Stream* m_stream;
+};
+
+CaptureFile_Stream::CaptureFile_Stream(QString path, bool bytePerBit, size_t history): CaptureFile(path)
+{
+    m_received = 0;
+    m_stop = false;
+    m_size = 0;
+    m_bytePerBit = bytePerBit;
+    m_named = path != "-";
+    m_reader = 0;
+    //Already in memory, caching it again would only cost memory
+    setCacheBudget(0);
+
+    if( m_named ) {
+#ifdef Q_OS_UNIX
+        //Opening a FIFO blocks until there is a writer
+        m_fd = open(path.toStdString().c_str(),O_RDONLY | O_NONBLOCK);
+#else
+        m_fd = open(path.toStdString().c_str(),O_RDONLY | O_BINARY);
+#endif
+    }
+    else {
+        m_fd = 0;
+#ifndef Q_OS_UNIX
+        _setmode(m_fd,O_BINARY);
+#endif
+    }
+    if( m_fd < 0 ) {
+        return;
+    }
+    m_ring.resize(qMax(qMin(history,(size_t)STREAM_MAX_HISTORY),(size_t)STREAM_CHUNK));
+    m_reader = new StreamReader(this);
+    m_reader->start();
+}
+
+CaptureFile_Stream::~CaptureFile_Stream() {
+    if( m_reader ) {
+        m_mutex.lock();
+        m_stop = true;
+        m_mutex.unlock();
+#ifdef Q_OS_UNIX
+        m_reader->wait();
+#else
+        //No way to wake a blocking read() here
+        if( !m_reader->wait(STREAM_POLL_MS*10) ) {
+            m_reader->terminate();
+            m_reader->wait();
+        }
+#endif
+        delete m_reader;
+    }
+    if( m_named && m_fd >= 0 ) {
+        close(m_fd);
+    }
+}
+
+bool CaptureFile_Stream::isStream(QString path) {
+    struct stat info;
+    if( path == "-" ) {
+        return true;
+    }
+    if( stat(path.toStdString().c_str(),&info) != 0 ) {
+        return false;
+    }
+    return !S_ISREG(info.st_mode) && !S_ISDIR(info.st_mode);
+}
+
+bool CaptureFile_Stream::isOpen() {
+    return m_reader != 0;
+}
+
+void CaptureFile_Stream::receive() {
+    char buf[STREAM_CHUNK];
+    qint64 got;
+    size_t start, first;
+#ifdef Q_OS_UNIX
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+#endif
+
+    for(;;) {
+        m_mutex.lock();
+        if( m_stop ) {
+            m_mutex.unlock();
+            break;
+        }
+        m_mutex.unlock();
+#ifdef Q_OS_UNIX
+        if( poll(&pfd,1,STREAM_POLL_MS) <= 0 ) {
+            continue;
+        }
+#endif
+        got = read(m_fd,buf,STREAM_CHUNK);
+        if( got < 0 && (errno == EAGAIN || errno == EINTR) ) {
+            continue;
+        }
+        if( got <= 0 ) {
+            if( !m_named || got < 0 ) {
+                break;
+            }
+            //The writer of a FIFO went away, another may open it
+            QThread::msleep(STREAM_POLL_MS);
+            continue;
+        }
+        QMutexLocker lock(&m_mutex);
+        start = m_received % m_ring.size();
+        first = qMin((size_t)got,m_ring.size()-start);
+        memcpy(m_ring.data()+start,buf,first);
+        memcpy(m_ring.data(),buf+first,got-first);
+        m_received = m_received + got;
+    }
+}
+
+quint64 CaptureFile_Stream::sizebit() {
+    return m_bytePerBit ? m_size : m_size*8;
+}
+
+quint64 CaptureFile_Stream::firstbit() {
+    QMutexLocker lock(&m_mutex);
+    quint64 first = m_received > (quint64)m_ring.size() ? m_received-m_ring.size() : 0;
+    return m_bytePerBit ? first : first*8;
+}
+
+bool CaptureFile_Stream::refresh() {
+    QMutexLocker lock(&m_mutex);
+    if( m_received == m_size ) {
+        return false;
+    }
+    m_size = m_received;
+    return true;
+}
+
+size_t CaptureFile_Stream::readbits(quint64 offset, size_t count, quint64* out) const {
+    static thread_local QByteArray bytes;
+    static thread_local QVector<quint64> words;
+    QMutexLocker lock(&m_mutex);
+    quint64 unit = m_bytePerBit ? 1 : 8;
+    quint64 first = m_received > (quint64)m_ring.size() ? m_received-m_ring.size() : 0;
+    quint64 start, end, byte, byteEnd;
+    size_t part;
+
+    memset(out,0,BitKernels::wordCount(count)*sizeof(quint64));
+    //Only what is still in the ring and was there at the last refresh()
+    start = qMax(offset,first*unit);
+    end = qMin(offset+count,m_size*unit);
+    if( start >= end ) {
+        return 0;
+    }
+
+    //Unwrap the bytes holding start to end
+    byte = start/unit;
+    byteEnd = (end+unit-1)/unit;
+    bytes.resize(byteEnd-byte);
+    part = qMin((quint64)bytes.size(),m_ring.size()-byte%m_ring.size());
+    memcpy(bytes.data(),m_ring.constData()+byte%m_ring.size(),part);
+    memcpy(bytes.data()+part,m_ring.constData(),bytes.size()-part);
+    lock.unlock();
+
+    if( start == offset ) {
+        if( m_bytePerBit ) {
+            BitKernels::packBytes((const unsigned char*)bytes.constData(),end-start,out,false);
+        }
+        else {
+            BitKernels::unpackBits((const unsigned char*)bytes.constData(),start%8,end-start,out,false);
+        }
+    }
+    else {
+        //The start of the request fell out of the history
+        words.resize(BitKernels::wordCount(end-start));
+        if( m_bytePerBit ) {
+            BitKernels::packBytes((const unsigned char*)bytes.constData(),end-start,words.data(),false);
+        }
+        else {
+            BitKernels::unpackBits((const unsigned char*)bytes.constData(),start%8,end-start,words.data(),false);
+        }
+        BitKernels::copyBits(out,start-offset,words.constData(),0,end-start);
+    }
+    //Bits are counted from offset, the lost ones before start read as zero
+    return end-offset;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef CAPTUREFILE_STREAM_H
+#define CAPTUREFILE_STREAM_H
+
+#include<QMutex>
+#include<QByteArray>
+#include"capturefile.h"
+
+//Default number of most recent bytes kept for scrolling back
+#define STREAM_DEFAULT_HISTORY (256*1024*1024)
+//Most history a stream keeps, the ring is a QByteArray indexed by int
+#define STREAM_MAX_HISTORY (2047*1024*1024)
+
+class StreamReader;
+
+//Reads stdin ("-") or a named pipe on a background thread into a ring
+//buffer holding the most recent history bytes.  New data shows up on
+//refresh(), data older than the history reads as zeros and firstbit()
+//tells where the available data starts.
+class CaptureFile_Stream: public CaptureFile
+{
+public:
+    CaptureFile_Stream(QString path, bool bytePerBit=false, size_t history=STREAM_DEFAULT_HISTORY);
+    virtual ~CaptureFile_Stream();
+    //True for "-" and anything that is not a regular file (pipes, FIFOs,
+    //character devices)
+    static bool isStream(QString path);
+    bool isOpen();
+    virtual quint64 sizebit();
+    virtual quint64 firstbit();
+    virtual bool refresh();
+
+protected:
+    virtual size_t readbits(quint64 offset, size_t count, quint64* out) const;
+
+private:
+    friend class StreamReader;
+    void receive();
+
+    int m_fd;
+    bool m_named;               //A named pipe, writers may come and go
+    StreamReader* m_reader;
+    mutable QMutex m_mutex;     //Guards the ring and m_received
+    QByteArray m_ring;          //Byte n of the stream is at n % m_ring.size()
+    quint64 m_received;         //Bytes read so far
+    bool m_stop;
+    quint64 m_size;             //m_received as of the last refresh()
+    bool m_bytePerBit;
+};
+
+#endif // CAPTUREFILE_STREAM_H
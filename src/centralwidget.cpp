@@ -42,14 +42,17 @@ CentralWidget::CentralWidget(QWidget *parent) : QWidget(parent)
     QGridLayout* rasterLayout = new QGridLayout();
     m_raster = new RasterWidget(this);
     m_vscroll = new QScrollBar(Qt::Vertical,this);
-    connect(m_vscroll,SIGNAL(valueChanged(int)),m_raster,SLOT(setVerticalOffset(int)));
+    connect(m_vscroll,SIGNAL(valueChanged(int)),this,SLOT(verticalScroll(int)));
+    connect(m_vscroll,SIGNAL(sliderMoved(int)),this,SLOT(verticalSliderMoved(int)));
     m_hscroll = new QScrollBar(Qt::Horizontal,this);
-    connect(m_hscroll,SIGNAL(valueChanged(int)),m_raster,SLOT(setHorizontalOffset(int)));
+    connect(m_hscroll,SIGNAL(valueChanged(int)),this,SLOT(horizontalScroll(int)));
     rasterLayout->addWidget(m_raster,0,0);
     rasterLayout->addWidget(m_vscroll,0,1);
     rasterLayout->addWidget(m_hscroll,1,0);
     m_hscroll->setRange(0,100);
     m_vscroll->setRange(0,100);
+    m_vscale = 1;
+    m_hscale = 1;
     mainLayout->addLayout(rasterLayout,1);
 
     m_captureFile = 0;
@@ -76,17 +79,59 @@ void CentralWidget::newSettings() {
     m_raster->setFramesPerLine(m_settings->fpl());
     m_raster->setFileOffset(m_settings->offset());
     m_raster->setZoom(m_settings->zoom());
+    m_raster->setShrink(m_settings->shrink());
     m_raster->setBitsPerPixels(m_settings->rbpp(), m_settings->gbpp(), m_settings->bbpp() );
     calcSizes();
 }
 
+void CentralWidget::verticalScroll(int value) {
+    quint64 offset = (quint64)value*m_vscale;
+    if( offset > m_raster->verticalMaximum() ) {
+        offset = m_raster->verticalMaximum();
+    }
+    m_raster->setVerticalOffset(offset);
+}
+
+void CentralWidget::verticalSliderMoved(int value) {
+    //Get the drag target loading before the repaint for it starts
+    m_raster->readAheadTo((quint64)value*m_vscale);
+}
+
+void CentralWidget::horizontalScroll(int value) {
+    quint64 offset = (quint64)value*m_hscale;
+    if( offset > m_raster->horizontalMaximum() ) {
+        offset = m_raster->horizontalMaximum();
+    }
+    m_raster->setHorizontalOffset(offset);
+}
+
 void CentralWidget::wheelEvent(QWheelEvent* event) {
     int delta = event->angleDelta().y();
     int zoom = m_settings->zoom();
-    if( delta > 0 ) { zoom = zoom + 1; }
-    else if( delta < 0 ) { zoom = zoom - 1; }
-    if( zoom < 1 ) { zoom = 1; }
+    int shrink = m_settings->shrink();
+    //Below 1:1 the wheel goes on zooming out by halves
+    if( delta > 0 && shrink > 1 ) { shrink = shrink / 2; }
+    else if( delta > 0 ) { zoom = zoom + 1; }
+    else if( delta < 0 && zoom > 1 ) { zoom = zoom - 1; }
+    else if( delta < 0 ) { shrink = shrink * 2; }
     m_settings->setZoom(zoom);
+    m_settings->setShrink(shrink);
+}
+
+void CentralWidget::captureGrown(bool autoScroll) {
+    quint64 vmax;
+    if( m_captureFile == 0 ) {
+        return;
+    }
+    m_raster->captureGrown(autoScroll);
+    //Extend the range around the current position (calcSizes() would keep
+    //the ratio instead and move the view)
+    vmax = m_raster->verticalMaximum();
+    m_vscale = vmax/INT_MAX + 1;
+    m_vscroll->blockSignals(true);
+    m_vscroll->setRange(0,vmax/m_vscale);
+    m_vscroll->setValue(m_raster->verticalOffset()/m_vscale);
+    m_vscroll->blockSignals(false);
 }
 
 void CentralWidget::calcSizes() {
@@ -97,19 +142,23 @@ void CentralWidget::calcSizes() {
         m_vscroll->setRange(0,0);
         m_hscroll->setValue(0);
         m_hscroll->setRange(0,0);
+        m_vscale = 1;
+        m_hscale = 1;
     }
     else {
-        size_t vmax = m_raster->verticalMaximum();
-        size_t hmax = m_raster->horizontalMaximum();
+        quint64 vmax = m_raster->verticalMaximum();
+        quint64 hmax = m_raster->horizontalMaximum();
         if( m_vscroll->maximum() ) {
             old_vscroll_ratio = (double)m_vscroll->value() / (double)m_vscroll->maximum();
         }
-        m_vscroll->setRange(0,vmax);
-        m_vscroll->setValue(old_vscroll_ratio*vmax);
+        m_vscale = vmax/INT_MAX + 1;
+        m_vscroll->setRange(0,vmax/m_vscale);
+        m_vscroll->setValue(old_vscroll_ratio*(vmax/m_vscale));
         if( m_hscroll->maximum() ) {
             old_hscroll_ratio = (double)m_hscroll->value() / (double)m_hscroll->maximum();
         }
-        m_hscroll->setRange(0,hmax);
-        m_hscroll->setValue(old_hscroll_ratio*hmax);
+        m_hscale = hmax/INT_MAX + 1;
+        m_hscroll->setRange(0,hmax/m_hscale);
+        m_hscroll->setValue(old_hscroll_ratio*(hmax/m_hscale));
     }
 }
@@ -38,6 +38,7 @@ class CentralWidget : public QWidget
 public:
     explicit CentralWidget(QWidget *parent = 0);
     void setCaptureFile(CaptureFile* captureFile);
+    void captureGrown(bool autoScroll);
     RasterWidget *raster();
     SettingsWidget* settings();
 
@@ -45,6 +46,9 @@ signals:
 
 public slots:
     void newSettings();
+    void verticalScroll(int value);
+    void verticalSliderMoved(int value);
+    void horizontalScroll(int value);
 
 protected:
     virtual void wheelEvent(QWheelEvent* event);
@@ -56,7 +60,10 @@ private:
     RasterWidget* m_raster;
     QScrollBar* m_vscroll;
     QScrollBar* m_hscroll;
-
+    //QScrollBar is limited to int, so larger rasters are scrolled
+    //in steps of this many lines/pixels
+    quint64 m_vscale;
+    quint64 m_hscale;
 
     void calcSizes();
 };
@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include "mainwindow.h"
+#include "capturefile_stream.h"
 #include <QApplication>
 #include <QFileInfo>
 #include <QDir>
@@ -33,7 +34,9 @@ void usage(char* cmd) {
     fprintf(stderr,"Usage:\n");
     fprintf(stderr,"%s [-h] [-ts ts] [[-bpts bpts] | [-bpl bpl]] [-fpl fpl] [-offset offset]\n",cmd);
     fprintf(stderr,"    [-zoom zoom] [-auto] [-tdm | -bin] [-invert] [-rbpp rbpp] [-gbpp gbpp]\n");
-    fprintf(stderr,"    [-bbpp bbpp] [-bit | -byte] [-file file]\n");
+    fprintf(stderr,"    [-bbpp bbpp] [-bit | -byte] [-nommap] [-directio] [-cache mb] [-follow]\n");
+    fprintf(stderr,"    [-noautoscroll] [-history mb] [-lsbfirst] [-swap16 | -swap32] [-diff]\n");
+    fprintf(stderr,"    [-file file]\n");
     fprintf(stderr,"\n");
     fprintf(stderr,"  ts     : Number of time slots (used with -tdm)\n");
     fprintf(stderr,"  bpts   : Bits per time slot (used with -tdm)\n");
@@ -45,12 +48,25 @@ void usage(char* cmd) {
     fprintf(stderr,"  tdm    : Set to Time Division Multiplex mode (default)\n");
     fprintf(stderr,"  bin    : Set to generic Binary mode\n");
     fprintf(stderr,"  invert : Invert bits\n");
+    fprintf(stderr,"  lsbfirst : Bytes of the file are least significant bit first\n");
+    fprintf(stderr,"  swap16 : Swap the bytes of each 16 bit word\n");
+    fprintf(stderr,"  swap32 : Reverse the bytes of each 32 bit word\n");
+    fprintf(stderr,"  diff   : Differential (NRZI) decode, a change of level is a one\n");
     fprintf(stderr,"  rbpp   : Red bits per pixel (default 0)\n");
     fprintf(stderr,"  gbpp   : Green bits per pixel (default 1)\n");
     fprintf(stderr,"  bbpp   : Blue bits per pixel (default 0)\n");
     fprintf(stderr,"  bit    : File is Bit per Byte\n");
     fprintf(stderr,"  byte   : File is Byte per Byte (default)\n");
-    fprintf(stderr,"  file   : File to analyze\n");
+    fprintf(stderr,"  nommap : Read file with stdio instead of memory mapping it\n");
+    fprintf(stderr,"  directio : Exports read around the page cache (O_DIRECT, with -nommap)\n");
+    fprintf(stderr,"  cache  : Megabytes of recently read file data kept in memory (default 64, 0 disables)\n");
+    fprintf(stderr,"  follow : Keep reading data appended to the file\n");
+    fprintf(stderr,"  noautoscroll : Do not scroll to new lines while following\n");
+    fprintf(stderr,"  history: Megabytes of a pipe kept for scrolling back (default 256, at most 2047)\n");
+    fprintf(stderr,"  file   : File to analyze (gzip and zstd files are read directly,\n");
+    fprintf(stderr,"           - reads stdin, pipes and FIFOs are followed as data arrives,\n");
+    fprintf(stderr,"           a wildcard pattern such as 'capture_*.bin' opens every matching\n");
+    fprintf(stderr,"           segment as one capture in name order)\n");
     exit(1);
 }
 
@@ -95,7 +111,7 @@ int main(int argc, char *argv[])
         }
         else if( strcmp(argv[i],"-offset") == 0) {
             if( i<argc-1 ) {
-                w.settings()->setOffset(atoi(argv[(i++)+1]));
+                w.settings()->setOffset(strtoull(argv[(i++)+1],0,0));
             }
             else { usage(argv[0]); }
         }
@@ -126,6 +142,18 @@ int main(int argc, char *argv[])
         else if( strcmp(argv[i],"-invert") == 0) {
             w.setInvert(true);
         }
+        else if( strcmp(argv[i],"-lsbfirst") == 0) {
+            w.addTransform(BitTransform::LsbFirst);
+        }
+        else if( strcmp(argv[i],"-swap16") == 0) {
+            w.addTransform(BitTransform::Swap16);
+        }
+        else if( strcmp(argv[i],"-swap32") == 0) {
+            w.addTransform(BitTransform::Swap32);
+        }
+        else if( strcmp(argv[i],"-diff") == 0) {
+            w.addTransform(BitTransform::Differential);
+        }
         else if( strcmp(argv[i],"-bit") == 0) {
             if( fileTypeSet ) { usage(argv[0]); }
             else {
@@ -140,6 +168,32 @@ int main(int argc, char *argv[])
                 w.setBytePerByte();
             }
         }
+        else if( strcmp(argv[i],"-nommap") == 0) {
+            w.setMemoryMap(false);
+        }
+        else if( strcmp(argv[i],"-directio") == 0) {
+            w.setDirectIO(true);
+        }
+        else if( strcmp(argv[i],"-cache") == 0) {
+            if( i<argc-1 ) {
+                w.setCacheBudget((size_t)strtoull(argv[(i++)+1],0,0)*1024*1024);
+            }
+            else { usage(argv[0]); }
+        }
+        else if( strcmp(argv[i],"-history") == 0) {
+            if( i<argc-1 ) {
+                unsigned long long history = strtoull(argv[(i++)+1],0,0);
+                if( history == 0 || history > STREAM_MAX_HISTORY/(1024*1024) ) { usage(argv[0]); }
+                w.setHistory((size_t)history*1024*1024);
+            }
+            else { usage(argv[0]); }
+        }
+        else if( strcmp(argv[i],"-follow") == 0) {
+            w.setFollow(true);
+        }
+        else if( strcmp(argv[i],"-noautoscroll") == 0) {
+            w.setAutoScroll(false);
+        }
         else if( strcmp(argv[i],"-file") == 0) {
             if( i<argc-1 ) {
                 path = argv[(i++)+1];
@@ -27,9 +27,18 @@
 #include <QMenuBar>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QFileInfo>
 #include "channelselectiondialog.h"
 #include <QDebug>
 
+//A capture being followed is checked for growth on every change
+//notification (at most once per FOLLOW_COALESCE_MS) and at least every
+//FOLLOW_POLL_MS
+#define FOLLOW_POLL_MS 1000
+#define FOLLOW_COALESCE_MS 100
+//Pipes cannot be watched, only polled
+#define FOLLOW_STREAM_POLL_MS 200
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent)
 {
@@ -40,6 +49,8 @@ MainWindow::MainWindow(QWidget *parent) :
     QMenu* fileMenu = menuBar()->addMenu("&File");
     action = fileMenu->addAction("&Open");
     connect(action,SIGNAL(triggered()),this,SLOT(openFile()));
+    action = fileMenu->addAction("Open &Segments");
+    connect(action,SIGNAL(triggered()),this,SLOT(openSegments()));
     fileMenu->addSeparator();
     m_byte_per_bit = fileMenu->addAction("File is Byte Per Bit");
     m_byte_per_bit->setCheckable(true);
@@ -55,7 +66,42 @@ MainWindow::MainWindow(QWidget *parent) :
     fileMenu->addSeparator();
     m_invert = fileMenu->addAction("Invert Bits");
     m_invert->setCheckable(true);
-    connect(m_invert,SIGNAL(triggered()),this,SLOT(setInvert()));
+    connect(m_invert,SIGNAL(triggered()),this,SLOT(setTransform()));
+    m_lsb_first = fileMenu->addAction("Bytes are LSB First");
+    m_lsb_first->setCheckable(true);
+    connect(m_lsb_first,SIGNAL(triggered()),this,SLOT(setTransform()));
+    m_no_swap = fileMenu->addAction("Bytes in Stored Order");
+    m_no_swap->setCheckable(true);
+    m_no_swap->setChecked(true);
+    connect(m_no_swap,SIGNAL(triggered()),this,SLOT(setTransform()));
+    m_swap16 = fileMenu->addAction("Swap Bytes of 16 Bit Words");
+    m_swap16->setCheckable(true);
+    connect(m_swap16,SIGNAL(triggered()),this,SLOT(setTransform()));
+    m_swap32 = fileMenu->addAction("Swap Bytes of 32 Bit Words");
+    m_swap32->setCheckable(true);
+    connect(m_swap32,SIGNAL(triggered()),this,SLOT(setTransform()));
+    m_swap_group = new QActionGroup(this);
+    m_swap_group->addAction(m_no_swap);
+    m_swap_group->addAction(m_swap16);
+    m_swap_group->addAction(m_swap32);
+    m_differential = fileMenu->addAction("Differential (NRZI) Decode");
+    m_differential->setCheckable(true);
+    connect(m_differential,SIGNAL(triggered()),this,SLOT(setTransform()));
+    fileMenu->addSeparator();
+    m_mmap = fileMenu->addAction("Memory Map File");
+    m_mmap->setCheckable(true);
+    m_mmap->setChecked(true);
+    connect(m_mmap,SIGNAL(triggered()),this,SLOT(setFileType()));
+    m_direct_io = fileMenu->addAction("Direct I/O for Exports");
+    m_direct_io->setCheckable(true);
+    m_direct_io->setChecked(false);
+    connect(m_direct_io,SIGNAL(triggered()),this,SLOT(setDirectIO()));
+    m_follow = fileMenu->addAction("&Follow File");
+    m_follow->setCheckable(true);
+    m_follow->setChecked(false);
+    connect(m_follow,SIGNAL(triggered()),this,SLOT(setFollow()));
+    action = fileMenu->addAction("Cache Statistics");
+    connect(action,SIGNAL(triggered()),this,SLOT(showCacheStatistics()));
     fileMenu->addSeparator();
     action = fileMenu->addAction("E&xit");
     connect(action,SIGNAL(triggered()),this,SLOT(close()));
@@ -92,6 +138,9 @@ MainWindow::MainWindow(QWidget *parent) :
     m_enable_colors->setCheckable(true);
     m_enable_colors->setChecked(false);
     connect(m_enable_colors,SIGNAL(triggered()),this,SLOT(setEnableColors()));
+    m_auto_scroll = uiMenu->addAction("Auto &Scroll");
+    m_auto_scroll->setCheckable(true);
+    m_auto_scroll->setChecked(true);
     uiMenu->addSeparator();
     m_tdm_mode = uiMenu->addAction("&TDM Mode");
     m_tdm_mode->setCheckable(true);
@@ -113,7 +162,19 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(m_central->raster(),SIGNAL(info(QString,QString)),this,SLOT(showInfo(QString,QString)));
 
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher,SIGNAL(fileChanged(QString)),this,SLOT(fileChanged()));
+    m_followPoll = new QTimer(this);
+    connect(m_followPoll,SIGNAL(timeout()),this,SLOT(checkGrowth()));
+    m_followCoalesce = new QTimer(this);
+    m_followCoalesce->setSingleShot(true);
+    m_followCoalesce->setInterval(FOLLOW_COALESCE_MS);
+    connect(m_followCoalesce,SIGNAL(timeout()),this,SLOT(checkGrowth()));
+
     m_captureFile = 0;
+    m_segmentFile = 0;
+    m_cacheBudget = BLOCKCACHE_DEFAULT_BUDGET;
+    m_history = STREAM_DEFAULT_HISTORY;
     resize(800,600);
 }
 
@@ -128,6 +189,16 @@ SettingsWidget* MainWindow::settings() {
 
 void MainWindow::setInvert(bool invert) {
         m_invert->setChecked(invert);
+        setTransform();
+}
+
+void MainWindow::addTransform(int flags) {
+    if( flags & BitTransform::Invert ) { m_invert->setChecked(true); }
+    if( flags & BitTransform::LsbFirst ) { m_lsb_first->setChecked(true); }
+    if( flags & BitTransform::Swap16 ) { m_swap16->setChecked(true); }
+    if( flags & BitTransform::Swap32 ) { m_swap32->setChecked(true); }
+    if( flags & BitTransform::Differential ) { m_differential->setChecked(true); }
+    setTransform();
 }
 
 void MainWindow::setBitPerByte() {
@@ -139,6 +210,39 @@ void MainWindow::setBytePerByte() {
     m_byte_per_bit->setChecked(true);
 }
 
+void MainWindow::setMemoryMap(bool memoryMap) {
+    m_mmap->setChecked(memoryMap);
+}
+
+void MainWindow::setDirectIO(bool directIO) {
+    m_direct_io->setChecked(directIO);
+    setDirectIO();
+}
+
+void MainWindow::setDirectIO() {
+    m_central->raster()->setDirectExport(m_direct_io->isChecked());
+}
+
+void MainWindow::setCacheBudget(size_t budget) {
+    m_cacheBudget = budget;
+    if( m_captureFile ) {
+        m_captureFile->setCacheBudget(budget);
+    }
+}
+
+void MainWindow::setHistory(size_t history) {
+    m_history = history;
+}
+
+void MainWindow::setFollow(bool follow) {
+    m_follow->setChecked(follow);
+    setFollow();
+}
+
+void MainWindow::setAutoScroll(bool autoScroll) {
+    m_auto_scroll->setChecked(autoScroll);
+}
+
 void MainWindow::setAutoUpdate(bool autoUpdate) {
     m_auto_update->setChecked(autoUpdate);
     m_central->settings()->setAutoUpdate(autoUpdate);
@@ -168,19 +272,94 @@ void MainWindow::openFile() {
     }
 }
 
-void MainWindow::openSpecifiedFile(QString path) {
-    m_path = path;
+void MainWindow::openSegments() {
+    QStringList paths = QFileDialog::getOpenFileNames(this,"Open Segments");
+    if( paths.size() ) {
+        //Dialogs return the selection in click order
+        paths.sort();
+        openSpecifiedSegments(paths);
+    }
+}
+
+void MainWindow::closeFile() {
     if( m_captureFile ) {
+        //Stop the raster (and its read ahead thread) using it first
+        m_central->setCaptureFile(0);
         delete m_captureFile;
+        m_captureFile = 0;
     }
-    if( m_byte_per_bit->isChecked() ) {
-        m_captureFile = (CaptureFile*)new CaptureFile_BytePerBit(path,m_invert->isChecked());
-    }
-    else {
-        m_captureFile = (CaptureFile*)new CaptureFile_BitPerBit(path,m_invert->isChecked());
-    }
+    m_segmentFile = 0;
+}
+
+void MainWindow::showFile() {
+    m_captureFile->setCacheBudget(m_cacheBudget);
+    m_captureFile->setTransform(transform());
     setWindowTitle(m_captureFile->fileName());
     m_central->setCaptureFile(m_captureFile);
+    setFollow();
+}
+
+void MainWindow::openSpecifiedSegments(QStringList paths) {
+    closeFile();
+    m_path = paths.first();
+    m_segments = paths;
+    m_segmentFile = new CaptureFile_Segments(paths,m_byte_per_bit->isChecked());
+    m_captureFile = (CaptureFile*)m_segmentFile;
+    showFile();
+}
+
+void MainWindow::openSpecifiedFile(QString path) {
+    closeFile();
+    m_path = path;
+    m_segments.clear();
+    if( CaptureFile_Segments::isPattern(path) ) {
+        m_segmentFile = new CaptureFile_Segments(path,m_byte_per_bit->isChecked());
+        m_captureFile = (CaptureFile*)m_segmentFile;
+    }
+    if( m_captureFile == 0 && CaptureFile_Stream::isStream(path) ) {
+        CaptureFile_Stream* stream = new CaptureFile_Stream(path,m_byte_per_bit->isChecked(),m_history);
+        if( stream->isOpen() ) {
+            m_captureFile = (CaptureFile*)stream;
+            //New data only shows up by following it
+            m_follow->setChecked(true);
+        }
+        else {
+            delete stream;
+        }
+    }
+    if( m_captureFile == 0 && CaptureFile_Compressed::detect(path) != CaptureFile_Compressed::None ) {
+        //The first open decompresses the whole file to index it
+        m_progress = new QProgressDialog("Indexing "+QFileInfo(path).fileName(),"Cancel",0,100,this);
+        m_progress->setWindowModality(Qt::WindowModal);
+        CaptureFile_Compressed* compressed = new CaptureFile_Compressed(path,m_byte_per_bit->isChecked(),m_progress);
+        m_progress->close();
+        if( compressed->isOpen() ) {
+            m_captureFile = (CaptureFile*)compressed;
+        }
+        else {
+            delete compressed;
+        }
+        if( m_captureFile == 0 && m_progress->wasCanceled() ) {
+            delete m_progress;
+            m_path = "";
+            return;
+        }
+        delete m_progress;
+    }
+    if( m_captureFile == 0 && m_mmap->isChecked() ) {
+        CaptureFile_MMap* mapped = new CaptureFile_MMap(path,m_byte_per_bit->isChecked());
+        if( mapped->isMapped() ) {
+            m_captureFile = (CaptureFile*)mapped;
+        }
+        else {
+            //Fall back to stdio (e.g. empty files or no address space)
+            delete mapped;
+        }
+    }
+    if( m_captureFile == 0 ) {
+        m_captureFile = (CaptureFile*)new CaptureFile_RawFile(path,m_byte_per_bit->isChecked());
+    }
+    showFile();
 }
 
 void MainWindow::saveViewableRaster() {
@@ -309,14 +488,107 @@ void MainWindow::findSync() {
 
 }
 
+void MainWindow::showCacheStatistics() {
+    BlockCache* cache;
+    TileCache* tiles;
+    quint64 hits, misses;
+    quint64 tileHits, tileMisses;
+    if( m_captureFile == 0 ) {
+        return;
+    }
+    cache = m_captureFile->cache();
+    hits = cache->hits();
+    misses = cache->misses();
+    tiles = m_central->raster()->tileCache();
+    tileHits = tiles->hits();
+    tileMisses = tiles->misses();
+    QMessageBox::information(this,"Cache Statistics",
+        QString("File data\nBudget: %1 MB\nHits: %2\nMisses: %3\nHit rate: %4%\n\n"
+                "Rendered tiles\nBudget: %5 MB\nHits: %6\nMisses: %7\nHit rate: %8%")
+            .arg(cache->budget()/(1024*1024))
+            .arg(hits)
+            .arg(misses)
+            .arg(hits+misses ? (100.0*hits)/(hits+misses) : 0.0,0,'f',1)
+            .arg(tiles->budget()/(1024*1024))
+            .arg(tileHits)
+            .arg(tileMisses)
+            .arg(tileHits+tileMisses ? (100.0*tileHits)/(tileHits+tileMisses) : 0.0,0,'f',1));
+}
+
+void MainWindow::setFollow() {
+    if( !m_watcher->files().isEmpty() ) {
+        m_watcher->removePaths(m_watcher->files());
+    }
+    m_followPoll->stop();
+    if( m_follow->isChecked() && m_path.length() != 0 ) {
+        if( CaptureFile_Stream::isStream(m_path) ) {
+            m_followPoll->setInterval(FOLLOW_STREAM_POLL_MS);
+        }
+        else {
+            m_watcher->addPath(followPath());
+            m_followPoll->setInterval(FOLLOW_POLL_MS);
+        }
+        m_followPoll->start();
+        checkGrowth();
+    }
+}
+
+void MainWindow::fileChanged() {
+    if( !m_followCoalesce->isActive() ) {
+        m_followCoalesce->start();
+    }
+}
+
+void MainWindow::checkGrowth() {
+    if( m_captureFile && m_captureFile->refresh() ) {
+        m_central->captureGrown(m_auto_scroll->isChecked());
+    }
+    //Some writers replace the file, which drops it from the watcher, and
+    //segment sets move on to new files
+    if( m_follow->isChecked() && !CaptureFile_Stream::isStream(m_path) && !m_watcher->files().contains(followPath()) ) {
+        if( !m_watcher->files().isEmpty() ) {
+            m_watcher->removePaths(m_watcher->files());
+        }
+        m_watcher->addPath(followPath());
+    }
+}
+
+QString MainWindow::followPath() {
+    //A recorder appends to the last segment of a set.  Earlier segments
+    //that are still being finished are found by the poll, which sizes
+    //them a few at a time (see CaptureFile_Segments::refresh()).
+    if( m_segmentFile && m_segmentFile->isOpen() ) {
+        return m_segmentFile->segments().last();
+    }
+    return m_path;
+}
+
 void MainWindow::setFileType() {
-    if( m_path.length() != 0 ) {
-        openSpecifiedFile(m_path);
+    reopenFile();
+}
+
+void MainWindow::setTransform() {
+    //Only changes how the data is read, the file stays open
+    if( m_captureFile ) {
+        m_central->raster()->setTransform(transform());
     }
 }
 
-void MainWindow::setInvert() {
-    if( m_path.length() != 0 ) {
+BitTransform MainWindow::transform() {
+    int flags = 0;
+    if( m_invert->isChecked() ) { flags |= BitTransform::Invert; }
+    if( m_lsb_first->isChecked() ) { flags |= BitTransform::LsbFirst; }
+    if( m_swap16->isChecked() ) { flags |= BitTransform::Swap16; }
+    if( m_swap32->isChecked() ) { flags |= BitTransform::Swap32; }
+    if( m_differential->isChecked() ) { flags |= BitTransform::Differential; }
+    return BitTransform(flags);
+}
+
+void MainWindow::reopenFile() {
+    if( m_segments.size() ) {
+        openSpecifiedSegments(m_segments);
+    }
+    else if( m_path.length() != 0 ) {
         openSpecifiedFile(m_path);
     }
 }
@@ -33,10 +33,14 @@
 #include <QBitArray>
 #include <QProgressDialog>
 #include <QCloseEvent>
+#include <QFileSystemWatcher>
 #include "centralwidget.h"
 #include "capturefile.h"
-#include "capturefile_bitperbit.h"
-#include "capturefile_byteperbit.h"
+#include "capturefile_rawfile.h"
+#include "capturefile_mmap.h"
+#include "capturefile_compressed.h"
+#include "capturefile_stream.h"
+#include "capturefile_segments.h"
 #include "infodialog.h"
 
 class MainWindow : public QMainWindow
@@ -48,16 +52,25 @@ public:
     ~MainWindow();
     SettingsWidget* settings();
     void setInvert(bool invert);
+    void addTransform(int flags);
     void setBitPerByte();
     void setBytePerByte();
+    void setMemoryMap(bool memoryMap);
+    void setDirectIO(bool directIO);
+    void setFollow(bool follow);
+    void setAutoScroll(bool autoScroll);
+    void setCacheBudget(size_t budget);
+    void setHistory(size_t history);
     void setAutoUpdate(bool autoUpdate);
     void setEnableColors(bool enableColors);
     void setTdmMode();
     void setBinMode();
     void openSpecifiedFile(QString path);
+    void openSpecifiedSegments(QStringList paths);
 
 public slots:
     void openFile();
+    void openSegments();
     void saveViewableRaster();
     void saveHorizontalRaster();
     void saveVerticalRaster();
@@ -67,8 +80,13 @@ public slots:
     void saveHorizontalTS();
     void saveEntireTS();
     void findSync();
+    void showCacheStatistics();
+    void setFollow();
+    void setDirectIO();
+    void fileChanged();
+    void checkGrowth();
     void setFileType();
-    void setInvert();
+    void setTransform();
     void setAutoUpdate();
     void setEnableColors();
     void setSettingsMode();
@@ -78,10 +96,29 @@ protected:
     virtual void closeEvent(QCloseEvent *event);
 
 private:
+    void closeFile();
+    void showFile();
+    void reopenFile();
+    QString followPath();
+    BitTransform transform();
+
     CentralWidget* m_central;
     QAction* m_byte_per_bit;
     QAction* m_bit_per_bit;
     QAction* m_invert;
+    QAction* m_lsb_first;
+    QAction* m_no_swap;
+    QAction* m_swap16;
+    QAction* m_swap32;
+    QActionGroup* m_swap_group;
+    QAction* m_differential;
+    QAction* m_mmap;
+    QAction* m_direct_io;
+    QAction* m_follow;
+    QAction* m_auto_scroll;
+    QFileSystemWatcher* m_watcher;
+    QTimer* m_followPoll;       //For file systems without change notification
+    QTimer* m_followCoalesce;   //Turns bursts of change notifications into one check
     QActionGroup* m_file_type_group;
     QAction* m_auto_update;
     QAction* m_enable_colors;
@@ -89,7 +126,11 @@ private:
     QAction *m_bin_mode;
     QActionGroup* m_mode_group;
     QString m_path;
+    QStringList m_segments;     //Explicitly chosen segment files, if any
+    size_t m_cacheBudget;
+    size_t m_history;
     CaptureFile* m_captureFile;
+    CaptureFile_Segments* m_segmentFile;   //m_captureFile when it is a segment set
     InfoDialog m_info;
     QProgressDialog *m_progress;
     QString m_savePath;
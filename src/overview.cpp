@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "overview.h"
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <string.h>
+#include "bitkernels.h"
+
+//Lines summed between publishing them to the pyramid, and the least time
+//between progress() signals
+#define OVERVIEW_BATCH_LINES 1024
+#define OVERVIEW_PROGRESS_MS 250
+
+//Lowest intensity of a cell with a single bit set among zeros (and the
+//highest of one with a single clear bit among ones), so they stay visible
+#define OVERVIEW_MIN_LEVEL 0x40
+
+static const OverviewCell emptyCell = { 0, 0, 0xFF, 0 };
+
+Overview::Overview(QObject *parent) : QThread(parent)
+{
+    m_captureFile = 0;
+    m_hasLayout = false;
+    m_restart = false;
+    m_more = false;
+    m_stop = false;
+    m_lines = 0;
+    m_done = false;
+    m_keepFirst = 0;
+    m_keepLast = 0;
+}
+
+Overview::~Overview() {
+    m_mutex.lock();
+    m_stop = true;
+    m_wake.wakeOne();
+    m_mutex.unlock();
+    wait();
+}
+
+void Overview::setCaptureFile(CaptureFile* captureFile) {
+    m_mutex.lock();
+    m_restart = true;
+    m_levels.clear();
+    m_mutex.unlock();
+    QMutexLocker busy(&m_busy);
+    QMutexLocker lock(&m_mutex);
+    m_captureFile = captureFile;
+    m_restart = true;
+    m_levels.clear();
+    m_lines = 0;
+    m_done = false;
+    m_wake.wakeOne();
+}
+
+void Overview::setLayout(const RasterLayout& layout) {
+    QMutexLocker lock(&m_mutex);
+    if( m_hasLayout && sameLayout(layout,m_layout) ) {
+        return;
+    }
+    m_layout = layout;
+    m_hasLayout = true;
+    m_restart = true;
+    m_levels.clear();
+    m_lines = 0;
+    m_done = false;
+    m_wake.wakeOne();
+}
+
+void Overview::grown() {
+    QMutexLocker lock(&m_mutex);
+    m_more = true;
+    m_done = false;
+    m_wake.wakeOne();
+}
+
+void Overview::rebuild() {
+    QMutexLocker lock(&m_mutex);
+    m_restart = true;
+    m_levels.clear();
+    m_lines = 0;
+    m_done = false;
+    m_wake.wakeOne();
+}
+
+void Overview::setKeep(quint64 first, quint64 last) {
+    QMutexLocker lock(&m_mutex);
+    m_keepFirst = first;
+    m_keepLast = last;
+}
+
+bool Overview::render(CaptureFile* captureFile, const RasterLayout& layout, QImage* target,
+                      quint64 row, quint64 column, unsigned int shrink, const QAtomicInt* cancel) {
+    int size = target->width();
+    QVector<OverviewCell> cells(size*size,emptyCell);
+    const Level* level = 0;
+    quint64 lines, line, rows;
+    unsigned int finest;
+    int i, j;
+
+    m_mutex.lock();
+    if( m_hasLayout && sameLayout(layout,m_layout) && !m_levels.isEmpty() ) {
+        finest = m_levels[0].shrink;
+        for( i=0; i<m_levels.size(); i++ ) {
+            if( m_levels[i].shrink == shrink ) {
+                level = &m_levels[i];
+            }
+        }
+    }
+    else {
+        finest = finestShrink(layout,lineCount(captureFile,layout));
+    }
+    if( level ) {
+        //Only whole tiles go into the tile cache, unless the file ends
+        //inside this one
+        if( !m_done && m_lines < (row+size)*shrink ) {
+            m_mutex.unlock();
+            return false;
+        }
+        rows = level->cells.size()/level->columns;
+        for( i=0; i<size && row+i<rows; i++ ) {
+            for( j=0; j<size && column+j<level->columns; j++ ) {
+                cells[i*size+j] = level->cells[(row+i)*level->columns+column+j];
+            }
+        }
+    }
+    m_mutex.unlock();
+
+    if( level == 0 ) {
+        if( shrink >= finest || captureFile == 0 ) {
+            //The pyramid will have it
+            return false;
+        }
+        //Finer than the pyramid keeps, sum it up from the file
+        lines = lineCount(captureFile,layout);
+        for( i=0; i<size; i++ ) {
+            for( line=(row+i)*shrink; line<(row+i+1)*shrink && line<lines; line++ ) {
+                if( cancel && cancel->loadAcquire() ) {
+                    return false;
+                }
+                addLine(captureFile,layout,line,column*shrink,shrink,cells.data()+i*size,size);
+            }
+        }
+    }
+
+    for( i=0; i<size; i++ ) {
+        for( j=0; j<size; j++ ) {
+            ((QRgb*)target->scanLine(i))[j] = color(layout,cells[i*size+j]);
+        }
+    }
+    return cancel == 0 || cancel->loadAcquire() == 0;
+}
+
+void Overview::run() {
+    CaptureFile* captureFile;
+    RasterLayout layout;
+    Level level;
+    quint64 lines;
+    unsigned int shrink;
+    for(;;) {
+        m_mutex.lock();
+        while( !m_stop && !(m_captureFile && m_hasLayout && (m_restart || m_more)) ) {
+            m_wake.wait(&m_mutex);
+        }
+        if( m_stop ) {
+            m_mutex.unlock();
+            break;
+        }
+        captureFile = m_captureFile;
+        layout = m_layout;
+        if( m_restart ) {
+            m_restart = false;
+            lines = lineCount(captureFile,layout);
+            m_levels.clear();
+            for( shrink=finestShrink(layout,lines); shrink<=OVERVIEW_MAX_SHRINK; shrink=shrink*2 ) {
+                level.shrink = shrink;
+                level.columns = qMax((layout.totalPixelWidth+shrink-1)/shrink,(quint64)1);
+                m_levels.append(level);
+            }
+            m_lines = 0;
+            m_done = false;
+            m_row.fill(emptyCell,(int)m_levels[0].columns);
+        }
+        m_more = false;
+        m_mutex.unlock();
+
+        m_busy.lock();
+        scan(captureFile,layout);
+        m_busy.unlock();
+        emit progress();
+    }
+}
+
+//Sums the lines the pyramid does not have yet into its finest level,
+//one batch at a time, until they are done or there is a new request
+void Overview::scan(CaptureFile* captureFile, const RasterLayout& layout) {
+    QElapsedTimer timer;
+    quint64 lines = lineCount(captureFile,layout);
+    quint64 line, end, batch, keepFirst, keepLast;
+    unsigned int shrink;
+    quint64 columns;
+
+    m_mutex.lock();
+    line = m_lines;
+    shrink = m_levels[0].shrink;
+    columns = m_levels[0].columns;
+    m_mutex.unlock();
+
+    timer.start();
+    captureFile->beginscan();
+    while( line < lines ) {
+        m_mutex.lock();
+        if( m_restart || m_stop ) {
+            m_mutex.unlock();
+            captureFile->endscan();
+            return;
+        }
+        keepFirst = m_keepFirst;
+        keepLast = m_keepLast;
+        m_mutex.unlock();
+        //A batch never crosses into the next row of cells
+        end = qMin(qMin(lines,line+OVERVIEW_BATCH_LINES),(line/shrink+1)*shrink);
+        batch = end-line;
+        captureFile->prefetch(layout.foffset+line*layout.totalBitWidth,(end-line)*layout.totalBitWidth);
+        for( ; line<end; line++ ) {
+            addLine(captureFile,layout,line,0,shrink,m_row.data(),columns);
+        }
+        //A transform set during the batch may have changed some of the
+        //bits, rebuild() starts over
+        if( captureFile->transform().flags() != layout.transform ) {
+            captureFile->endscan();
+            return;
+        }
+        //Like an export, the scan should not push out everything else, but
+        //what the view shows stays
+        if( end-batch < qMin(end,keepFirst) ) {
+            captureFile->release(layout.foffset+(end-batch)*layout.totalBitWidth,(qMin(end,keepFirst)-(end-batch))*layout.totalBitWidth);
+        }
+        if( qMax(end-batch,keepLast) < end ) {
+            captureFile->release(layout.foffset+qMax(end-batch,keepLast)*layout.totalBitWidth,(end-qMax(end-batch,keepLast))*layout.totalBitWidth);
+        }
+        publish(line);
+        if( line%shrink == 0 ) {
+            m_row.fill(emptyCell);
+        }
+        if( timer.elapsed() >= OVERVIEW_PROGRESS_MS ) {
+            emit progress();
+            timer.restart();
+        }
+    }
+    captureFile->endscan();
+    m_mutex.lock();
+    if( !m_restart && !m_more ) {
+        m_done = true;
+    }
+    m_mutex.unlock();
+}
+
+//Stores the finest row of cells holding line lines-1 and rebuilds the
+//rows above it in the coarser levels
+void Overview::publish(quint64 lines) {
+    QMutexLocker lock(&m_mutex);
+    quint64 row = (lines-1)/m_levels[0].shrink;
+    quint64 column, r, c;
+    int i;
+    if( m_restart ) {
+        return;
+    }
+    if( (quint64)m_levels[0].cells.size() < (row+1)*m_levels[0].columns ) {
+        m_levels[0].cells.resize((row+1)*m_levels[0].columns);
+    }
+    memcpy(m_levels[0].cells.data()+row*m_levels[0].columns,m_row.constData(),m_levels[0].columns*sizeof(OverviewCell));
+    for( i=1; i<m_levels.size(); i++ ) {
+        const Level& finer = m_levels[i-1];
+        Level& level = m_levels[i];
+        row = row/2;
+        if( (quint64)level.cells.size() < (row+1)*level.columns ) {
+            level.cells.resize((row+1)*level.columns);
+        }
+        for( column=0; column<level.columns; column++ ) {
+            OverviewCell& cell = level.cells[row*level.columns+column];
+            cell = emptyCell;
+            for( r=row*2; r<row*2+2 && r<finer.cells.size()/finer.columns; r++ ) {
+                for( c=column*2; c<column*2+2 && c<finer.columns; c++ ) {
+                    merge(&cell,finer.cells[r*finer.columns+c]);
+                }
+            }
+        }
+    }
+    m_lines = lines;
+}
+
+bool Overview::sameLayout(const RasterLayout& a, const RasterLayout& b) {
+    return a.foffset == b.foffset && a.ts == b.ts && a.bpts == b.bpts && a.fpl == b.fpl &&
+           a.rbpp == b.rbpp && a.gbpp == b.gbpp && a.bbpp == b.bbpp && a.transform == b.transform;
+}
+
+quint64 Overview::lineCount(CaptureFile* captureFile, const RasterLayout& layout) {
+    if( captureFile == 0 || layout.totalBitWidth == 0 || captureFile->sizebit() <= layout.foffset ) {
+        return 0;
+    }
+    return (captureFile->sizebit()-layout.foffset)/layout.totalBitWidth;
+}
+
+//The smallest reduction whose pyramid fits the budget
+unsigned int Overview::finestShrink(const RasterLayout& layout, quint64 lines) {
+    unsigned int shrink = 2;
+    quint64 cells;
+    for( ; shrink<OVERVIEW_MAX_SHRINK; shrink=shrink*2 ) {
+        cells = ((layout.totalPixelWidth+shrink-1)/shrink) * ((lines+shrink-1)/shrink);
+        //The coarser levels add up to a third of the finest
+        if( cells*sizeof(OverviewCell)*4/3 <= OVERVIEW_BUDGET ) {
+            break;
+        }
+    }
+    return shrink;
+}
+
+//Adds raster line line to count cells of shrink pixels each, the first
+//starting at pixel hOffset.  Time slot gaps add nothing.
+void Overview::addLine(CaptureFile* captureFile, const RasterLayout& layout, quint64 line, quint64 hOffset,
+                       unsigned int shrink, OverviewCell* cells, unsigned int count) {
+    static thread_local QVector<quint64> lineBits;
+    static thread_local QVector<quint64> tsBits;
+    quint64 lineOffset = layout.foffset + line*layout.totalBitWidth;
+    quint64 tsBitWidth = (quint64)layout.bpts*layout.fpl;
+    quint64 tsWidth = layout.tsPixelWidth-1;
+    quint64 last = qMin(hOffset+(quint64)count*shrink,layout.totalPixelWidth);
+    quint64 pixel, end, bit, bits, ones;
+    unsigned int ts, tsFirst, tsLast, pixelOnes;
+    OverviewCell* cell;
+
+    if( hOffset >= last || lineOffset+layout.totalBitWidth <= captureFile->firstbit() ) {
+        return;
+    }
+    tsFirst = hOffset/layout.tsPixelWidth;
+    tsLast = (last-1)/layout.tsPixelWidth;
+    lineBits.resize(BitKernels::wordCount(layout.totalBitWidth));
+    tsBits.resize(BitKernels::wordCount(tsBitWidth));
+    captureFile->extractbits(lineOffset + tsFirst*layout.bpts,
+                             (layout.fpl-1)*layout.frameBitWidth + (tsLast-tsFirst+1)*layout.bpts,
+                             lineBits.data());
+
+    for( ts=tsFirst; ts<=tsLast; ts++ ) {
+        BitKernels::gatherBits(tsBits.data(),lineBits.constData(),(ts-tsFirst)*layout.bpts,layout.frameBitWidth,layout.bpts,layout.fpl);
+        pixel = qMax(hOffset,(quint64)ts*layout.tsPixelWidth) - ts*layout.tsPixelWidth;
+        //Each pass covers the pixels of the time slot that share a cell
+        while( pixel < tsWidth && ts*layout.tsPixelWidth+pixel < last ) {
+            cell = cells + (ts*layout.tsPixelWidth+pixel-hOffset)/shrink;
+            end = qMin(tsWidth,qMin(last,hOffset+((ts*layout.tsPixelWidth+pixel-hOffset)/shrink+1)*shrink) - ts*layout.tsPixelWidth);
+            bit = pixel*layout.totalBitsPerPixel;
+            //The last pixel of a time slot can be short of bits
+            bits = qMin(end*layout.totalBitsPerPixel,tsBitWidth) - bit;
+            ones = BitKernels::countBits(tsBits.constData(),bit,bits);
+            cell->ones = cell->ones + ones;
+            cell->bits = cell->bits + bits;
+            if( layout.totalBitsPerPixel == 1 ) {
+                cell->min = qMin(cell->min,(quint8)(ones == bits ? 1 : 0));
+                cell->max = qMax(cell->max,(quint8)(ones ? 1 : 0));
+            }
+            else {
+                for( ; bit<qMin(end*layout.totalBitsPerPixel,tsBitWidth); bit+=layout.totalBitsPerPixel ) {
+                    pixelOnes = BitKernels::countBits(tsBits.constData(),bit,qMin((quint64)layout.totalBitsPerPixel,tsBitWidth-bit));
+                    cell->min = qMin(cell->min,(quint8)pixelOnes);
+                    cell->max = qMax(cell->max,(quint8)pixelOnes);
+                }
+            }
+            pixel = end;
+        }
+    }
+}
+
+void Overview::merge(OverviewCell* cell, const OverviewCell& other) {
+    cell->ones = cell->ones + other.ones;
+    cell->bits = cell->bits + other.bits;
+    cell->min = qMin(cell->min,other.min);
+    cell->max = qMax(cell->max,other.max);
+}
+
+//Shows the share of set bits as the intensity of the layout's colors
+QRgb Overview::color(const RasterLayout& layout, const OverviewCell& cell) {
+    unsigned int level;
+    if( cell.bits == 0 ) {
+        return qRgb(0x80,0x80,0x80);
+    }
+    level = (unsigned int)((cell.ones*255 + cell.bits/2)/cell.bits);
+    if( cell.max > 0 && level < OVERVIEW_MIN_LEVEL ) {
+        level = OVERVIEW_MIN_LEVEL;
+    }
+    else if( cell.min < layout.totalBitsPerPixel && level > 0xFF-OVERVIEW_MIN_LEVEL ) {
+        level = 0xFF-OVERVIEW_MIN_LEVEL;
+    }
+    return qRgb(layout.rbpp ? level : 0,layout.gbpp ? level : 0,layout.bbpp ? level : 0);
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QVector>
+#include <QImage>
+#include <QAtomicInt>
+#include "capturefile.h"
+#include "rasterrenderer.h"
+
+//Largest reduction of the raster along each side (a power of two) and the
+//memory the levels of the pyramid may use between them
+#define OVERVIEW_MAX_SHRINK (1<<20)
+#define OVERVIEW_BUDGET (32*1024*1024)
+
+//A block of raster pixels summed up
+struct OverviewCell {
+    quint64 ones;           //Data bits set in the block
+    quint64 bits;           //Data bits in the block (none for gaps and past the end)
+    quint8 min;             //Fewest and most bits set in one pixel of the block
+    quint8 max;
+};
+
+//Background thread that summarizes the capture for zooming out.  For the
+//current layout it scans the whole file once and keeps a pyramid of
+//cells, each level halving the one below along lines and columns.  The
+//finest level is as fine as OVERVIEW_BUDGET allows, finer reductions are
+//summed from the file when a tile asks for them.
+class Overview : public QThread
+{
+    Q_OBJECT
+public:
+    explicit Overview(QObject *parent = 0);
+    ~Overview();
+    //Waits for a scan of the old file to stop, so the old file can be
+    //deleted once this returns
+    void setCaptureFile(CaptureFile* captureFile);
+    //Starts over unless the pyramid is already for layout
+    void setLayout(const RasterLayout& layout);
+    //Picks up lines appended to the capture
+    void grown();
+    //Starts over, lines already summed up have changed (or the capture's
+    //transform)
+    void rebuild();
+    //Lines first to last are cached for the view, the scan reads them
+    //without releasing them
+    void setKeep(quint64 first, quint64 last);
+    //Renders the tile of the raster shrunk by shrink whose top left cell
+    //is row, column into target.  Returns false if the pyramid has not got
+    //that far yet or cancel was set.
+    bool render(CaptureFile* captureFile, const RasterLayout& layout, QImage* target,
+                quint64 row, quint64 column, unsigned int shrink, const QAtomicInt* cancel = 0);
+
+signals:
+    //More of the pyramid is built
+    void progress();
+
+protected:
+    virtual void run();
+
+private:
+    struct Level {
+        unsigned int shrink;
+        quint64 columns;
+        QVector<OverviewCell> cells;    //Rows of columns cells
+    };
+    void scan(CaptureFile* captureFile, const RasterLayout& layout);
+    void publish(quint64 lines);
+    static bool sameLayout(const RasterLayout& a, const RasterLayout& b);
+    static quint64 lineCount(CaptureFile* captureFile, const RasterLayout& layout);
+    static unsigned int finestShrink(const RasterLayout& layout, quint64 lines);
+    static void addLine(CaptureFile* captureFile, const RasterLayout& layout, quint64 line, quint64 hOffset,
+                        unsigned int shrink, OverviewCell* cells, unsigned int count);
+    static void merge(OverviewCell* cell, const OverviewCell& other);
+    static QRgb color(const RasterLayout& layout, const OverviewCell& cell);
+
+    QMutex m_mutex;         //Guards the request and the pyramid
+    QMutex m_busy;          //Held while calling into the file
+    QWaitCondition m_wake;
+    CaptureFile* m_captureFile;
+    RasterLayout m_layout;  //What the pyramid is (being) built for
+    bool m_hasLayout;
+    bool m_restart;
+    bool m_more;            //The file grew
+    bool m_stop;
+    QVector<Level> m_levels;
+    quint64 m_lines;        //Lines in the pyramid
+    bool m_done;            //They are all the file has
+    quint64 m_keepFirst;    //Lines the view keeps cached
+    quint64 m_keepLast;
+    QVector<OverviewCell> m_row;    //Finest cells of the lines past the last whole row
+};
+
+#endif // OVERVIEW_H
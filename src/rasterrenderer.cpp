@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rasterrenderer.h"
+#include <QThread>
+#include <QRunnable>
+#include <string.h>
+#include "bitkernels.h"
+
+//Lines a render thread takes at a time
+#define RENDER_BAND_LINES 16
+
+struct RasterRenderer::PixelTables {
+    unsigned int rbpp;
+    unsigned int gbpp;
+    unsigned int bbpp;
+    unsigned int maxRed;
+    unsigned int maxGreen;
+    unsigned int maxBlue;
+    QRgb bytes[256][8];     //The pixels packed in each byte value, for 1, 2, 4 and 8 bits per pixel
+    quint8 level8[256];     //Intensity of each value of an 8 bit channel
+};
+
+//Intensity of a channel value out of max (max of a 32 bit channel
+//wraps to 0xFFFFFFFF)
+static inline unsigned int channelLevel(unsigned int value, unsigned int max) {
+    if( value ) {
+        value = (unsigned int)( ((double)value / (double)max)*255 ) & 0xFF;
+    }
+    return value;
+}
+
+static inline unsigned int channelMax(unsigned int bits) {
+    return bits==32?0xFFFFFFFF:(1<<bits)-1;
+}
+
+//Each pool thread takes the next band of lines until none are left or
+//the render is cancelled
+class RenderTask: public QRunnable
+{
+public:
+    RenderTask(const RasterRenderer* renderer, const RasterRenderer::Job* job, unsigned int first, unsigned int last, QAtomicInt* next, const QAtomicInt* cancel) {
+        m_renderer = renderer;
+        m_job = job;
+        m_first = first;
+        m_last = last;
+        m_next = next;
+        m_cancel = cancel;
+    }
+    virtual void run() {
+        unsigned int line;
+        while( (m_cancel == 0 || m_cancel->loadAcquire() == 0) &&
+               (line = m_first + (unsigned int)m_next->fetchAndAddOrdered(1)*RENDER_BAND_LINES) < m_last ) {
+            m_renderer->renderLines(*m_job,line,qMin(line+RENDER_BAND_LINES,m_last));
+        }
+    }
+
+private:
+    const RasterRenderer* m_renderer;
+    const RasterRenderer::Job* m_job;
+    unsigned int m_first;
+    unsigned int m_last;
+    QAtomicInt* m_next;
+    const QAtomicInt* m_cancel;
+};
+
+RasterRenderer::RasterRenderer() {
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+RasterRenderer::~RasterRenderer() {
+    m_pool.waitForDone();
+}
+
+int RasterRenderer::threadCount() const {
+    return m_pool.maxThreadCount();
+}
+
+bool RasterRenderer::render(CaptureFile* captureFile, const RasterLayout& layout, QImage* target,
+                            quint64 vOffset, quint64 hOffset, unsigned int zoom,
+                            unsigned int first, unsigned int last, const QAtomicInt* cancel) {
+    Job job;
+    PixelTables tables;
+    QAtomicInt next(0);
+    RenderTask task(this,&job,first,last,&next,cancel);
+    unsigned int ts;
+    unsigned int columnCount = (target->width()+zoom-1)/zoom;
+    quint64 pixel, column;
+    int bands = (last-first+RENDER_BAND_LINES-1)/RENDER_BAND_LINES;
+    int row, i;
+    const QRgb white = qRgb(0xFF,0xFF,0xFF);
+    const QRgb gray = qRgb(0x80,0x80,0x80);
+
+    for( row=first*zoom; row<(int)(last*zoom) && row<target->height(); row++ ) {
+        for( i=0; i<target->width(); i++ ) {
+            ((QRgb*)target->scanLine(row))[i] = gray;
+        }
+    }
+    if( captureFile == 0 || columnCount == 0 || last <= first ) {
+        return true;
+    }
+
+    //Let the backend start pulling in this part of the file
+    captureFile->prefetch(layout.foffset+layout.totalBitWidth*(vOffset+first),(quint64)(last-first)*layout.totalBitWidth);
+
+    job.captureFile = captureFile;
+    job.layout = &layout;
+    buildTables(layout,&tables);
+    job.tables = &tables;
+    job.kernel = pickKernel(layout);
+    job.target = target;
+    job.vOffset = vOffset;
+    job.hOffset = hOffset;
+    job.zoom = zoom;
+    //White columns seperate timeslots, gray lies past the last one
+    job.background.resize(columnCount);
+    for( column=0; column<columnCount; column++ ) {
+        pixel = hOffset+column;
+        if( pixel < layout.totalPixelWidth && pixel%layout.tsPixelWidth == layout.tsPixelWidth-1 ) {
+            job.background[column] = white;
+        }
+        else {
+            job.background[column] = gray;
+        }
+    }
+    //Find the time slots that land on the target
+    job.tsFirst = layout.ts;
+    job.tsLast = 0;
+    for( ts=0; ts<layout.ts; ts++ ) {
+        if( (ts+1)*layout.tsPixelWidth < hOffset+2 ) { continue; }
+        else if( ts*layout.tsPixelWidth >= hOffset+columnCount ) { break; }
+        if( job.tsFirst == layout.ts ) { job.tsFirst = ts; }
+        job.tsLast = ts;
+    }
+
+    //The calling thread renders bands too
+    for( i=1; i<qMin(bands,m_pool.maxThreadCount()); i++ ) {
+        m_pool.start(new RenderTask(this,&job,first,last,&next,cancel));
+    }
+    task.run();
+    m_pool.waitForDone();
+    return cancel == 0 || cancel->loadAcquire() == 0;
+}
+
+//Writes each line's pixels once into a scan line of the target, then
+//copies it for the remaining rows of the zoom.  Runs on the pool.
+void RasterRenderer::renderLines(const Job& job, unsigned int first, unsigned int last) const {
+    static thread_local QVector<quint64> lineBits;
+    static thread_local QVector<quint64> tsBits;
+    static thread_local QVector<QRgb> pixels;
+    const RasterLayout& layout = *job.layout;
+    unsigned int line,ts,z;
+    quint64 pixel, column;
+    quint64 lineOffset;
+    int y, row;
+    int width = job.target->width();
+    unsigned int zoom = job.zoom;
+    unsigned int columnCount = job.background.size();
+    QRgb* scan;
+
+    lineBits.resize(BitKernels::wordCount(layout.totalBitWidth));
+    tsBits.resize(BitKernels::wordCount((layout.tsPixelWidth-1)*layout.totalBitsPerPixel));
+    pixels.resize(columnCount);
+
+    for( line=first; line<last; line++ ) {
+        lineOffset = layout.foffset + (job.vOffset+line)*layout.totalBitWidth;
+        if( lineOffset > job.captureFile->sizebit() ) {
+            //Past the end stays gray
+            break;
+        }
+        memcpy(pixels.data(),job.background.constData(),columnCount*sizeof(QRgb));
+        if( job.tsFirst != layout.ts && lineOffset+layout.totalBitWidth > job.captureFile->firstbit() ) {
+            //One read covers the visible time slots of every frame in the line
+            job.captureFile->extractbits(lineOffset + job.tsFirst*layout.bpts,
+                                         (layout.fpl-1)*layout.frameBitWidth + (job.tsLast-job.tsFirst+1)*layout.bpts,
+                                         lineBits.data());
+
+            for( ts=job.tsFirst; ts<=job.tsLast; ts++ ) {
+                //Make tsBits big enough to generate all of the pixel for a time slot
+                //if the bpp needed is more than the bit represented then we will fill
+                //with extra zeros.
+                tsBits.fill(0);
+                BitKernels::gatherBits(tsBits.data(),lineBits.constData(),(ts-job.tsFirst)*layout.bpts,layout.frameBitWidth,layout.bpts,layout.fpl);
+
+                //Skip straight to the first pixel on the target
+                pixel = 0;
+                if( ts*layout.tsPixelWidth < job.hOffset ) {
+                    pixel = job.hOffset-ts*layout.tsPixelWidth;
+                }
+                column = ts*layout.tsPixelWidth + pixel - job.hOffset;
+                if( pixel < layout.tsPixelWidth-1 && column < columnCount ) {
+                    job.kernel(*job.tables,tsBits.constData(),pixel*layout.totalBitsPerPixel,pixels.data()+column,
+                               qMin(layout.tsPixelWidth-1-pixel,columnCount-column));
+                }
+            }
+        }
+
+        //Widen each pixel to zoom columns, then repeat the scan line for
+        //the rows below it
+        y = line*zoom;
+        scan = (QRgb*)job.target->scanLine(y);
+        if( zoom == 1 ) {
+            memcpy(scan,pixels.constData(),columnCount*sizeof(QRgb));
+        }
+        else {
+            for( column=0; column<columnCount; column++ ) {
+                for( z=0; z<zoom && column*zoom+z<(quint64)width; z++ ) {
+                    scan[column*zoom+z] = pixels[column];
+                }
+            }
+        }
+        for( row=y+1; row<y+(int)zoom && row<job.target->height(); row++ ) {
+            memcpy(job.target->scanLine(row),scan,width*sizeof(QRgb));
+        }
+    }
+}
+
+void RasterRenderer::buildTables(const RasterLayout& layout, PixelTables* tables) {
+    unsigned int bits = layout.totalBitsPerPixel;
+    unsigned int value, byte, i;
+    tables->rbpp = layout.rbpp;
+    tables->gbpp = layout.gbpp;
+    tables->bbpp = layout.bbpp;
+    tables->maxRed = channelMax(layout.rbpp);
+    tables->maxGreen = channelMax(layout.gbpp);
+    tables->maxBlue = channelMax(layout.bbpp);
+    for( value=0; value<256; value++ ) {
+        tables->level8[value] = channelLevel(value,0xFF);
+    }
+    if( bits == 0 || bits > 8 || 8%bits ) {
+        return;
+    }
+    //Pixels are packed MSB first with red in their top bits
+    for( byte=0; byte<256; byte++ ) {
+        for( i=0; i<8/bits; i++ ) {
+            value = (byte >> (8-bits*(i+1))) & ((1<<bits)-1);
+            tables->bytes[byte][i] = qRgb(channelLevel(value >> (layout.gbpp+layout.bbpp),tables->maxRed),
+                                          channelLevel((value >> layout.bbpp) & tables->maxGreen,tables->maxGreen),
+                                          channelLevel(value & tables->maxBlue,tables->maxBlue));
+        }
+    }
+}
+
+RasterRenderer::PixelKernel RasterRenderer::pickKernel(const RasterLayout& layout) {
+    switch( layout.totalBitsPerPixel ) {
+    case 1: return &RasterRenderer::packedPixels<1>;
+    case 2: return &RasterRenderer::packedPixels<2>;
+    case 4: return &RasterRenderer::packedPixels<4>;
+    case 8: return &RasterRenderer::packedPixels<8>;
+    }
+    if( layout.rbpp == 8 && layout.gbpp == 8 && layout.bbpp == 8 ) {
+        return &RasterRenderer::rgb888Pixels;
+    }
+    return &RasterRenderer::genericPixels;
+}
+
+//1, 2, 4 or 8 bits per pixel: the pixels of each whole byte come from one
+//table lookup (8 of them for the default 1 bit green)
+template<unsigned int BPP>
+void RasterRenderer::packedPixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count) {
+    const unsigned int perByte = 8/BPP;
+    unsigned int byte;
+    while( count && bit%8 ) {
+        *out++ = tables.bytes[BitKernels::fetchBits(bits,bit,BPP) << (8-BPP)][0];
+        bit = bit + BPP;
+        count--;
+    }
+    while( count >= perByte ) {
+        byte = (bits[bit/64] >> (56-bit%64)) & 0xFF;
+        memcpy(out,tables.bytes[byte],perByte*sizeof(QRgb));
+        out = out + perByte;
+        bit = bit + 8;
+        count = count - perByte;
+    }
+    while( count ) {
+        *out++ = tables.bytes[BitKernels::fetchBits(bits,bit,BPP) << (8-BPP)][0];
+        bit = bit + BPP;
+        count--;
+    }
+}
+
+void RasterRenderer::rgb888Pixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count) {
+    quint64 value;
+    for( ; count; count--, bit+=24 ) {
+        value = BitKernels::fetchBits(bits,bit,24);
+        *out++ = qRgb(tables.level8[value >> 16],tables.level8[(value >> 8) & 0xFF],tables.level8[value & 0xFF]);
+    }
+}
+
+//Any other split of bits, one channel at a time
+void RasterRenderer::genericPixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count) {
+    unsigned int red, green, blue;
+    for( ; count; count-- ) {
+        red = 0;
+        if( tables.rbpp ) {
+            red = channelLevel(BitKernels::fetchBits(bits,bit,tables.rbpp),tables.maxRed);
+            bit = bit + tables.rbpp;
+        }
+        green = 0;
+        if( tables.gbpp ) {
+            green = channelLevel(BitKernels::fetchBits(bits,bit,tables.gbpp),tables.maxGreen);
+            bit = bit + tables.gbpp;
+        }
+        blue = 0;
+        if( tables.bbpp ) {
+            blue = channelLevel(BitKernels::fetchBits(bits,bit,tables.bbpp),tables.maxBlue);
+            bit = bit + tables.bbpp;
+        }
+        *out++ = qRgb(red,green,blue);
+    }
+}
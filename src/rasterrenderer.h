@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RASTERRENDERER_H
+#define RASTERRENDERER_H
+
+#include <QImage>
+#include <QVector>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include "capturefile.h"
+
+//How the capture is laid out as a raster.  Renders take a copy so they
+//can go on while the widget's settings change.
+struct RasterLayout {
+    quint64 foffset;                //File offset
+    unsigned int ts;                //Number of time slots
+    unsigned int bpts;              //Bits per time slot
+    unsigned int fpl;               //Frames per line
+    unsigned int rbpp;              //Red, green and blue bits per pixel
+    unsigned int gbpp;
+    unsigned int bbpp;
+    int transform;                  //BitTransform flags of the file
+    quint64 totalBitWidth;          //Total bits represented per line
+    quint64 frameBitWidth;          //Total bits that represent a single frame in the file
+    unsigned int totalBitsPerPixel; //Total number of bits represented by each pixel
+    quint64 tsPixelWidth;           //Total pixels needed to represent each timeslot (with 1 for a buffer)
+    quint64 totalPixelWidth;        //Total pixels per line
+};
+
+class RenderTask;
+
+//Renders the raster into QImage scan lines.  Bands of lines are rendered
+//in parallel on a thread pool, each into its own scan lines of the
+//target.  One render runs at a time per renderer.
+class RasterRenderer
+{
+    friend class RenderTask;
+public:
+    RasterRenderer();
+    ~RasterRenderer();
+    int threadCount() const;
+    //Renders lines first to last of target, whose top left pixel is line
+    //vOffset and pixel hOffset of the raster.  Returns false if it stopped
+    //early because cancel was set.
+    bool render(CaptureFile* captureFile, const RasterLayout& layout, QImage* target,
+                quint64 vOffset, quint64 hOffset, unsigned int zoom,
+                unsigned int first, unsigned int last, const QAtomicInt* cancel = 0);
+
+private:
+    //Lookup tables for the layout's bits per pixel, and the kernel that
+    //turns a run of pixel bits into pixels with them
+    struct PixelTables;
+    typedef void (*PixelKernel)(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count);
+
+    //What render() hands to each band of lines
+    struct Job {
+        CaptureFile* captureFile;
+        const RasterLayout* layout;
+        QImage* target;
+        quint64 vOffset;
+        quint64 hOffset;
+        unsigned int zoom;
+        unsigned int tsFirst;           //Time slots that land on the target
+        unsigned int tsLast;
+        QVector<QRgb> background;       //A line's pixels before its data
+        const PixelTables* tables;
+        PixelKernel kernel;
+    };
+    static void buildTables(const RasterLayout& layout, PixelTables* tables);
+    static PixelKernel pickKernel(const RasterLayout& layout);
+    template<unsigned int BPP> static void packedPixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count);
+    static void rgb888Pixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count);
+    static void genericPixels(const PixelTables& tables, const quint64* bits, size_t bit, QRgb* out, size_t count);
+    void renderLines(const Job& job, unsigned int first, unsigned int last) const;
+
+    QThreadPool m_pool;
+};
+
+#endif // RASTERRENDERER_H
@@ -30,6 +30,52 @@
 #include <QTextStream>
 #include <QDebug>
 #include <QApplication>
+#include <QVector>
+#include <QFile>
+#include <QMessageBox>
+#include <string.h>
+#include "bitkernels.h"
+#include "rasterwriter.h"
+
+//QProgressDialog ranges are int, so exports of more lines than that
+//report their progress in fixed steps instead
+#define PROGRESS_STEPS 10000
+
+//Screens read ahead in the scroll direction, plus however many lines the
+//current scroll speed covers in READAHEAD_SECONDS.  A pause longer than
+//READAHEAD_IDLE_MS starts a new scroll.
+#define READAHEAD_SCREENS 2
+#define READAHEAD_SECONDS 0.5
+#define READAHEAD_IDLE_MS 500
+
+//Bytes of the file exports keep in flight ahead of the line being written
+//(twice this stays well inside the default block cache budget)
+#define EXPORT_READAHEAD (16*1024*1024)
+
+//Bytes of output exports collect before writing them out
+#define EXPORT_WRITE_BUFFER (4*1024*1024)
+
+//Lines per render thread an export renders between progress updates
+#define RENDER_EXPORT_LINES 256
+
+//Most bytes of image a streamed export renders at once, wide rasters
+//render fewer lines per strip
+#define EXPORT_STRIP_BYTES (64*1024*1024)
+
+//Least time between redraws of the whole view, holds typing with auto
+//update on to about 30 frames a second
+#define RENDER_FRAME_MS 33
+
+//How often saving a zoomed out view checks whether the overview has got
+//as far as the view
+#define OVERVIEW_POLL_MS 50
+
+static int progressValue(quint64 done, quint64 total) {
+    if( total == 0 ) {
+        return 0;
+    }
+    return (int)(((double)done / (double)total)*PROGRESS_STEPS);
+}
 
 RasterWidget::RasterWidget(QWidget *parent) : QWidget(parent)
 {
@@ -46,11 +92,36 @@ RasterWidget::RasterWidget(QWidget *parent) : QWidget(parent)
     m_hoffset = 0;
     m_voffset = 0;
     m_captureFile = 0;
+    m_scrollVelocity = 0;
+    m_directExport = false;
+    m_exportReleased = 0;
+    m_readAhead = new ReadAhead(this);
+    m_readAhead->start();
+    m_shrink = 1;
+    m_overview = new Overview(this);
+    connect(m_overview,SIGNAL(progress()),this,SLOT(overviewProgress()));
+    m_overview->start(QThread::LowPriority);
+    m_tileRenderer = new TileRenderer(&m_tiles,m_overview,this);
+    connect(m_tileRenderer,SIGNAL(tileReady(quint64,quint64)),this,SLOT(tileReady(quint64,quint64)));
+    m_tileRenderer->start();
+    m_invalidateTimer = new QTimer(this);
+    m_invalidateTimer->setSingleShot(true);
+    connect(m_invalidateTimer,SIGNAL(timeout()),this,SLOT(redraw()));
     calculateSizes();
 }
 
+RasterWidget::~RasterWidget() {
+    //Stop before the tile cache goes away
+    delete m_tileRenderer;
+    delete m_overview;
+}
+
 void RasterWidget::setCaptureFile(CaptureFile* captureFile) {
     m_captureFile = captureFile;
+    m_readAhead->setCaptureFile(captureFile);
+    m_tileRenderer->setCaptureFile(captureFile);
+    m_overview->setCaptureFile(captureFile);
+    m_tiles.clear();
     calculateSizes();
 }
 
@@ -75,7 +146,7 @@ void RasterWidget::setFramesPerLine(unsigned int fpl) {
     }
 }
 
-void RasterWidget::setFileOffset(unsigned int offset) {
+void RasterWidget::setFileOffset(quint64 offset) {
     if( offset != m_foffset ) {
         m_foffset = offset;
         calculateSizes();
@@ -83,9 +154,21 @@ void RasterWidget::setFileOffset(unsigned int offset) {
 }
 
 void RasterWidget::setZoom(unsigned int zoom) {
-    if( zoom > 0 ) {
+    if( zoom > 0 && zoom != m_zoom ) {
         m_zoom = zoom;
-        repaint();
+        invalidate();
+    }
+}
+
+//Zooms out, each pixel of the view sums up shrink by shrink pixels of the
+//raster.  1 shows the raster as it is.
+void RasterWidget::setShrink(unsigned int shrink) {
+    if( shrink > 0 && shrink != m_shrink ) {
+        m_shrink = shrink;
+        //The view starts on a whole cell
+        m_hoffset = m_hoffset - m_hoffset%m_shrink;
+        m_voffset = m_voffset - m_voffset%m_shrink;
+        invalidate();
     }
 }
 
@@ -98,25 +181,195 @@ void RasterWidget::setBitsPerPixels(unsigned int rbpp, unsigned int gbpp, unsign
     }
 }
 
-void RasterWidget::setHorizontalOffset(int offset) {
-    if( (unsigned int)offset != m_hoffset ) {
-        m_hoffset = (unsigned int)offset;
-        repaint();
+void RasterWidget::setTransform(BitTransform transform) {
+    if( m_captureFile == 0 || m_captureFile->transform() == transform ) {
+        return;
+    }
+    m_captureFile->setTransform(transform);
+    //Tiles are keyed by the transform, the overview may have summed up
+    //lines read partly through each
+    m_overview->rebuild();
+    invalidate();
+}
+
+void RasterWidget::setHorizontalOffset(quint64 offset) {
+    qint64 dx;
+    offset = offset - offset%m_shrink;
+    dx = toScreen(m_hoffset,offset);
+    if( offset != m_hoffset ) {
+        m_hoffset = offset;
+        scrollFrame(dx,0);
+    }
+}
+
+void RasterWidget::setVerticalOffset(quint64 offset) {
+    quint64 oldOffset = m_voffset;
+    qint64 dy;
+    offset = offset - offset%m_shrink;
+    dy = toScreen(m_voffset,offset);
+    if( offset != m_voffset ) {
+        m_voffset = offset;
+        readAhead(oldOffset);
+        scrollFrame(0,dy);
+    }
+}
+
+//Moves what is already drawn by the scroll, only the exposed strip is
+//drawn again
+void RasterWidget::scrollFrame(qint64 dx, qint64 dy) {
+    int w = width();
+    int h = height();
+    int i, y;
+    QPainter painter;
+
+    if( m_frame.size() != this->size() || qAbs(dx) >= w || qAbs(dy) >= h ) {
+        update();
+        return;
+    }
+    //Walk the rows against the direction of the move so none is
+    //overwritten before it is copied
+    for( i=0; i<h-qAbs(dy); i++ ) {
+        y = dy > 0 ? h-1-i : i;
+        if( dx >= 0 ) {
+            memmove(m_frame.scanLine(y)+dx*4,m_frame.constScanLine(y-dy),(w-dx)*4);
+        }
+        else {
+            memmove(m_frame.scanLine(y),m_frame.constScanLine(y-dy)-dx*4,(w+dx)*4);
+        }
+    }
+    //Until its tiles arrive the exposed strip shows as background
+    painter.begin(&m_frame);
+    if( dx > 0 ) {
+        painter.fillRect(0,0,dx,h,QColor(0x80,0x80,0x80));
+    }
+    else if( dx < 0 ) {
+        painter.fillRect(w+dx,0,-dx,h,QColor(0x80,0x80,0x80));
+    }
+    if( dy > 0 ) {
+        painter.fillRect(0,0,w,dy,QColor(0x80,0x80,0x80));
+    }
+    else if( dy < 0 ) {
+        painter.fillRect(0,h+dy,w,-dy,QColor(0x80,0x80,0x80));
+    }
+    painter.end();
+    scroll(dx,dy);
+}
+
+void RasterWidget::readAheadTo(quint64 offset) {
+    quint64 visible = height()/m_zoom+1;
+    if( m_shrink > 1 ) {
+        //Overviews read what they need themselves
+        return;
+    }
+    requestLines(offset > visible ? offset-visible : 0,visible*3);
+}
+
+void RasterWidget::readAhead(quint64 oldOffset) {
+    quint64 visible = height()/m_zoom+1;
+    qint64 elapsed = READAHEAD_IDLE_MS;
+    double delta = (double)m_voffset - (double)oldOffset;
+    quint64 ahead;
+
+    if( m_shrink > 1 ) {
+        return;
+    }
+    if( m_scrollTimer.isValid() ) {
+        elapsed = m_scrollTimer.restart();
+    }
+    else {
+        m_scrollTimer.start();
+    }
+    if( elapsed >= READAHEAD_IDLE_MS ) {
+        m_scrollVelocity = 0;
+    }
+    else {
+        m_scrollVelocity = 0.5*m_scrollVelocity + 0.5*(delta*1000.0/qMax(elapsed,(qint64)1));
+    }
+    ahead = visible*READAHEAD_SCREENS + (quint64)(qAbs(m_scrollVelocity)*READAHEAD_SECONDS);
+    if( delta > 0 ) {
+        requestLines(m_voffset+visible,ahead);
+    }
+    else if( m_voffset > ahead ) {
+        requestLines(m_voffset-ahead,ahead);
+    }
+    else {
+        requestLines(0,m_voffset);
+    }
+}
+
+void RasterWidget::requestLines(quint64 first, quint64 count) {
+    if( m_captureFile == 0 || first >= m_totalPixelHeight ) {
+        return;
+    }
+    count = qMin(count,m_totalPixelHeight-first);
+    if( count ) {
+        m_readAhead->request(m_foffset+first*m_totalBitWidth,count*m_totalBitWidth);
+    }
+}
+
+void RasterWidget::setDirectExport(bool direct) {
+    m_directExport = direct;
+}
+
+TileCache* RasterWidget::tileCache() {
+    return &m_tiles;
+}
+
+//Exports scan the capture once front to back, so the lines they are
+//done with are released rather than left to push the view's data (and
+//everything else) out of the caches
+void RasterWidget::beginExport(quint64 firstLine) {
+    m_exportReleased = firstLine;
+    if( m_captureFile ) {
+        m_captureFile->beginscan(m_directExport);
+    }
+}
+
+//Called for every line of an export; each time it passes *next the
+//following EXPORT_READAHEAD bytes are queued so the disk works on them
+//(as one batch of block reads) while this thread formats the data.
+void RasterWidget::exportAhead(quint64 line, quint64 lastLine, quint64* next) {
+    quint64 lines = qMax((quint64)1,(quint64)EXPORT_READAHEAD*8/qMax(m_totalBitWidth,(quint64)1));
+    if( line >= *next && line < lastLine ) {
+        *next = line+lines;
+        releaseLines(m_exportReleased,line);
+        m_exportReleased = line;
+        requestLines(line,qMin(2*lines,lastLine-line));
+    }
+}
+
+void RasterWidget::endExport(quint64 line) {
+    if( m_captureFile ) {
+        releaseLines(m_exportReleased,line);
+        m_captureFile->endscan();
     }
 }
 
-void RasterWidget::setVerticalOffset(int offset) {
-    if( (unsigned int)offset != m_voffset ) {
-        m_voffset = (unsigned int)offset;
-        repaint();
+//Lines around the view that exports and the overview leave cached
+void RasterWidget::keepLines(quint64* first, quint64* last) {
+    quint64 visible = height()/qMax(m_zoom,1u)+1;
+    quint64 keep = visible*(READAHEAD_SCREENS+1);
+    *first = m_voffset > keep ? m_voffset-keep : 0;
+    *last = m_voffset+visible+keep;
+}
+
+//Releases lines first to last, except those on or near the screen
+void RasterWidget::releaseLines(quint64 first, quint64 last) {
+    quint64 keepFirst, keepLast;
+    keepLines(&keepFirst,&keepLast);
+    if( first < qMin(last,keepFirst) ) {
+        m_captureFile->release(m_foffset+first*m_totalBitWidth,(qMin(last,keepFirst)-first)*m_totalBitWidth);
+    }
+    if( qMax(first,keepLast) < last ) {
+        m_captureFile->release(m_foffset+qMax(first,keepLast)*m_totalBitWidth,(last-qMax(first,keepLast))*m_totalBitWidth);
     }
 }
 
-unsigned int RasterWidget::horizontalMaximum() {
+quint64 RasterWidget::horizontalMaximum() {
     return m_totalPixelWidth;
 }
 
-unsigned int RasterWidget::verticalMaximum() {
+quint64 RasterWidget::verticalMaximum() {
     return m_totalPixelHeight;
 }
 
@@ -131,9 +384,9 @@ void RasterWidget::calculateSizes() {
         m_totalPixelHeight = 0;
     }
     else {
-        m_totalBitWidth = m_bpts*m_ts*m_fpl;
-        m_tsBitWidth = m_bpts*m_fpl;
-        m_frameBitWidth = m_ts*m_bpts;
+        m_totalBitWidth = (quint64)m_bpts*m_ts*m_fpl;
+        m_tsBitWidth = (quint64)m_bpts*m_fpl;
+        m_frameBitWidth = (quint64)m_ts*m_bpts;
         m_totalBitsPerPixel = m_rbpp + m_gbpp + m_bbpp;
         m_tsPixelWidth = m_tsBitWidth/m_totalBitsPerPixel;
         if( m_tsBitWidth % m_totalBitsPerPixel ) {
@@ -143,14 +396,159 @@ void RasterWidget::calculateSizes() {
         //Plus 1 for buffer between time slots
         m_tsPixelWidth = m_tsPixelWidth + 1;
         m_totalPixelWidth = m_tsPixelWidth*m_ts-1;
+        calculateHeight();
+    }
+    invalidate();
+}
+
+//Settings arrive in bursts (one Update sets them all), they are drawn
+//together once control returns to the event loop
+void RasterWidget::invalidate() {
+    qint64 wait = 0;
+    if( m_invalidateTimer->isActive() ) {
+        return;
+    }
+    if( m_frameTimer.isValid() ) {
+        wait = qMax(RENDER_FRAME_MS - m_frameTimer.elapsed(),(qint64)0);
+    }
+    m_invalidateTimer->start(wait);
+}
+
+void RasterWidget::redraw() {
+    m_frameTimer.start();
+    update();
+}
+
+RasterLayout RasterWidget::layout() {
+    RasterLayout layout;
+    layout.foffset = m_foffset;
+    layout.ts = m_ts;
+    layout.bpts = m_bpts;
+    layout.fpl = m_fpl;
+    layout.rbpp = m_rbpp;
+    layout.gbpp = m_gbpp;
+    layout.bbpp = m_bbpp;
+    layout.transform = m_captureFile ? m_captureFile->transform().flags() : 0;
+    layout.totalBitWidth = m_totalBitWidth;
+    layout.frameBitWidth = m_frameBitWidth;
+    layout.totalBitsPerPixel = m_totalBitsPerPixel;
+    layout.tsPixelWidth = m_tsPixelWidth;
+    layout.totalPixelWidth = m_totalPixelWidth;
+    return layout;
+}
+
+//Screen pixels from the view's origin at origin to raster pixel (or line)
+//pixel, both on whole cells of an overview
+qint64 RasterWidget::toScreen(quint64 pixel, quint64 origin) {
+    if( m_shrink > 1 ) {
+        return (qint64)(pixel/m_shrink) - (qint64)(origin/m_shrink);
+    }
+    return ((qint64)pixel - (qint64)origin)*m_zoom;
+}
+
+//Raster pixels (or lines) covered by screen pixels of the view
+quint64 RasterWidget::toRaster(int screen) {
+    if( m_shrink > 1 ) {
+        return (quint64)screen*m_shrink;
+    }
+    return screen/m_zoom;
+}
+
+//Lines the view shows from m_voffset on, which the horizontal exports
+//save.  Zoomed far out the screen reaches past the end of the raster.
+quint64 RasterWidget::viewLines() {
+    quint64 lines = toRaster(height());
+    if( m_shrink > 1 ) {
+        lines = qMin(lines,m_totalPixelHeight > m_voffset ? m_totalPixelHeight-m_voffset : 0);
+    }
+    return lines;
+}
+
+//Pixels of a line the view shows from m_hoffset on
+quint64 RasterWidget::viewColumns() {
+    quint64 columns = toRaster(width());
+    if( m_shrink > 1 ) {
+        columns = qMin(columns,m_totalPixelWidth > m_hoffset ? m_totalPixelWidth-m_hoffset : 0);
+    }
+    return columns;
+}
+
+TileKey RasterWidget::tileKey(quint64 row, quint64 column) {
+    TileKey key;
+    key.offset = m_foffset;
+    key.ts = m_ts;
+    key.bpts = m_bpts;
+    key.fpl = m_fpl;
+    key.rbpp = m_rbpp;
+    key.gbpp = m_gbpp;
+    key.bbpp = m_bbpp;
+    key.transform = m_captureFile ? m_captureFile->transform().flags() : 0;
+    key.shrink = m_shrink;
+    key.row = row;
+    key.column = column;
+    return key;
+}
+
+void RasterWidget::calculateHeight() {
+    if( m_captureFile->sizebit() > m_foffset ) {
         m_totalPixelHeight = (m_captureFile->sizebit()-m_foffset) / m_totalBitWidth;
     }
-    repaint();
+    else {
+        m_totalPixelHeight = 0;
+    }
+}
+
+quint64 RasterWidget::verticalOffset() {
+    return m_voffset;
+}
+
+void RasterWidget::captureGrown(bool autoScroll) {
+    quint64 oldHeight = m_totalPixelHeight;
+    quint64 completeLines = qMax(toRaster(height()),(quint64)1);
+    quint64 offset = m_voffset;
+    quint64 changed;
+    qint64 dy, y;
+
+    if( m_captureFile == 0 ) {
+        return;
+    }
+    calculateHeight();
+    //Segment sets can also move lines that were already there
+    changed = m_captureFile->changedbit();
+    changed = changed > m_foffset ? (changed-m_foffset)/qMax(m_totalBitWidth,(quint64)1) : 0;
+    if( changed < oldHeight ) {
+        m_tiles.invalidateLines(changed);
+        m_overview->rebuild();
+    }
+    else if( m_totalPixelHeight > oldHeight ) {
+        //Tiles from the old end of the file on were drawn short
+        changed = oldHeight;
+        m_tiles.invalidateLines(oldHeight);
+        m_overview->grown();
+    }
+    else {
+        return;
+    }
+    //Keep following the newest complete lines if they were on screen
+    if( autoScroll && m_voffset+completeLines >= oldHeight && m_totalPixelHeight > completeLines ) {
+        offset = qMax(m_totalPixelHeight-completeLines,m_voffset);
+        offset = offset - offset%m_shrink;
+    }
+    if( offset != m_voffset ) {
+        dy = toScreen(offset,m_voffset);
+        m_voffset = offset;
+        scrollFrame(0,-dy);
+    }
+    //The line that held the old end of the file was drawn partially
+    y = changed > m_voffset ? toScreen(changed,m_voffset) : 0;
+    if( y < height() ) {
+        update(0,y,width(),height()-y);
+    }
 }
 
 void RasterWidget::mouseMoveEvent(QMouseEvent* event) {
     QString tip;
-    unsigned int ts = ( (event->x()/m_zoom) + m_hoffset) / m_tsPixelWidth;
+    quint64 ts = ( toRaster(event->x()) + m_hoffset) / m_tsPixelWidth;
     if( ts < m_ts ) {
         QTextStream tipstream(&tip);
         tipstream << "TS:" << ts;
@@ -160,23 +558,14 @@ void RasterWidget::mouseMoveEvent(QMouseEvent* event) {
 }
 
 void RasterWidget::mouseDoubleClickEvent(QMouseEvent *event) {
-    size_t line = (event->y()/m_zoom)+m_voffset;
-    size_t ts = ((event->x()/m_zoom)+m_hoffset) / m_tsPixelWidth;
+    quint64 line = toRaster(event->y())+m_voffset;
+    quint64 ts = (toRaster(event->x())+m_hoffset) / m_tsPixelWidth;
     //qDebug() << event->x() << " " << event->x()/m_zoom << " " << m_hoffset;
-    size_t fileLineOffset = m_foffset + line*m_totalBitWidth;
-    size_t frame;
-    int i;
-    QBitArray data(m_bpts*m_fpl,false);
-    QBitArray *bits;
+    quint64 fileLineOffset = m_foffset + line*m_totalBitWidth;
+    size_t i;
+    QVector<quint64> data(BitKernels::wordCount(m_bpts*m_fpl));
 
-    for( frame=0; frame<m_fpl; frame++ ) {
-         m_captureFile->seekbit(fileLineOffset + frame*m_frameBitWidth + ts*m_bpts );
-         bits = m_captureFile->readbit(m_bpts);
-         for( i=0; i<bits->size(); i++ ) {
-             data.setBit(frame*m_bpts+i,bits->testBit(i));
-         }
-         delete bits;
-    }
+    m_captureFile->gatherbits(fileLineOffset + ts*m_bpts, m_frameBitWidth, m_bpts, m_fpl, data.data());
 
     QString labelstr;
     QTextStream labelstream(&labelstr);
@@ -184,8 +573,8 @@ void RasterWidget::mouseDoubleClickEvent(QMouseEvent *event) {
     QTextStream datastream(&datastr);
 
     labelstream << "File:" << m_captureFile->fileName() << " " << "TS:" << ts << " " << "Line:" << line;
-    for( i=0; i<data.size(); i++ ) {
-        if( data.testBit(i) ) {
+    for( i=0; i<m_bpts*m_fpl; i++ ) {
+        if( BitKernels::testBit(data.constData(),i) ) {
             datastream << "1";
         }
         else {
@@ -195,163 +584,367 @@ void RasterWidget::mouseDoubleClickEvent(QMouseEvent *event) {
     emit info(labelstr,datastr);
 }
 
+//Draws the cached tiles crossing the exposed area into the frame and
+//shows it.  Tiles of the view that are not cached are rendered in the
+//background, until they arrive the frame keeps what was there before.
 void RasterWidget::paintEvent(QPaintEvent* event) {
-    paintRaster(this,m_voffset,m_hoffset,m_zoom);
+    QRect area = event->rect();
+    QPainter painter;
+    quint64 firstRow, lastRow, firstColumn, lastColumn;
+    quint64 row, column;
+    quint64 keepFirst, keepLast;
+    int x, y;
+    unsigned int zoom = m_shrink > 1 ? 1 : m_zoom;
+    int size = TILECACHE_TILE_SIZE*zoom;
+    //The view's origin in tile pixels
+    quint64 vOffset = m_voffset/m_shrink;
+    quint64 hOffset = m_hoffset/m_shrink;
+    QList<TileKey> missing;
+    TileKey key;
+    QRect rect;
+    QImage tile;
+
+    if( m_frame.size() != this->size() ) {
+        m_frame = QImage(this->size(),QImage::Format_RGB32);
+        m_frame.fill(qRgb(0x80,0x80,0x80));
+    }
+    if( m_captureFile == 0 || width() == 0 || height() == 0 ) {
+        m_frame.fill(qRgb(0x80,0x80,0x80));
+    }
+    else {
+        //Before a new layout starts a scan that would release them
+        keepLines(&keepFirst,&keepLast);
+        m_overview->setKeep(keepFirst,keepLast);
+        m_overview->setLayout(layout());
+        firstRow = vOffset/TILECACHE_TILE_SIZE;
+        lastRow = (vOffset + (height()-1)/zoom)/TILECACHE_TILE_SIZE;
+        firstColumn = hOffset/TILECACHE_TILE_SIZE;
+        lastColumn = (hOffset + (width()-1)/zoom)/TILECACHE_TILE_SIZE;
+        painter.begin(&m_frame);
+        painter.setClipRect(area);
+        for( row=firstRow; row<=lastRow; row++ ) {
+            for( column=firstColumn; column<=lastColumn; column++ ) {
+                key = tileKey(row,column);
+                x = ((qint64)(column*TILECACHE_TILE_SIZE) - (qint64)hOffset)*zoom;
+                y = ((qint64)(row*TILECACHE_TILE_SIZE) - (qint64)vOffset)*zoom;
+                rect = QRect(x,y,size,size);
+                if( !rect.intersects(area) ) {
+                    if( !m_tiles.contains(key) ) {
+                        missing.append(key);
+                    }
+                    continue;
+                }
+                tile = m_tiles.lookup(key);
+                if( tile.isNull() ) {
+                    missing.append(key);
+                }
+                else if( zoom == 1 ) {
+                    painter.drawImage(x,y,tile);
+                }
+                else {
+                    painter.drawImage(rect,tile);
+                }
+            }
+        }
+        painter.end();
+    }
+    //Also drops whatever was waiting for an older view or layout
+    m_tileRenderer->request(layout(),missing);
+
+    painter.begin(this);
+    painter.drawImage(area,m_frame,area);
+    painter.end();
     event->accept();
 }
 
+void RasterWidget::tileReady(quint64 row, quint64 column) {
+    unsigned int zoom = m_shrink > 1 ? 1 : m_zoom;
+    qint64 x = ((qint64)(column*TILECACHE_TILE_SIZE) - (qint64)(m_hoffset/m_shrink))*zoom;
+    qint64 y = ((qint64)(row*TILECACHE_TILE_SIZE) - (qint64)(m_voffset/m_shrink))*zoom;
+    int size = TILECACHE_TILE_SIZE*zoom;
+    if( x < width() && y < height() && x+size > 0 && y+size > 0 ) {
+        update(QRect(x,y,size,size));
+    }
+}
+
+void RasterWidget::overviewProgress() {
+    if( m_shrink > 1 ) {
+        invalidate();
+    }
+}
+
 void RasterWidget::saveViewableRaster(QString path, QProgressDialog* dlg) {
-    QImage target(QSize(width(),height()),QImage::Format_RGB16);
-    paintRaster(&target,m_voffset,m_hoffset,m_zoom,dlg);
+    QImage target(QSize(width(),height()),QImage::Format_RGB32);
+    if( m_shrink > 1 ) {
+        paintOverview(&target,dlg);
+    }
+    else {
+        paintRaster(&target,m_voffset,m_hoffset,m_zoom,dlg);
+    }
     target.save(path);
 }
 
 void RasterWidget::saveHorizontalRaster(QString path, QProgressDialog* dlg) {
-    QImage target(QSize(m_totalPixelWidth,height()/m_zoom),QImage::Format_RGB16);
-    paintRaster(&target,m_voffset,0,1,dlg);
-    target.save(path);
+    if( RasterWriter::canWrite(path) ) {
+        streamRaster(path,m_voffset,0,m_totalPixelWidth,viewLines(),dlg);
+        return;
+    }
+    saveImage(path,m_voffset,0,m_totalPixelWidth,viewLines(),dlg);
 }
 
 void RasterWidget::saveVerticalRaster(QString path, QProgressDialog* dlg) {
-    QImage target(QSize(width()/m_zoom,m_totalPixelHeight),QImage::Format_RGB16);
-    paintRaster(&target,0,m_hoffset,1,dlg);
-    target.save(path);
+    if( RasterWriter::canWrite(path) ) {
+        streamRaster(path,0,m_hoffset,viewColumns(),m_totalPixelHeight,dlg);
+        return;
+    }
+    saveImage(path,0,m_hoffset,viewColumns(),m_totalPixelHeight,dlg);
 }
 
 void RasterWidget::saveEntireRaster(QString path, QProgressDialog* dlg) {
-    QImage target(QSize(m_totalPixelWidth,m_totalPixelHeight),QImage::Format_RGB16);
-    paintRaster(&target,0,0,1,dlg);
-    target.save(path);
+    if( RasterWriter::canWrite(path) ) {
+        streamRaster(path,0,0,m_totalPixelWidth,m_totalPixelHeight,dlg);
+        return;
+    }
+    saveImage(path,0,0,m_totalPixelWidth,m_totalPixelHeight,dlg);
 }
 
-void RasterWidget::paintRaster(QPaintDevice* target, size_t vOffset, size_t hOffset, size_t zoom, QProgressDialog* dlg) {
-    unsigned int y,line,frame,ts,pixel,bit;
-    int x, bitOffset;
-    size_t baseFileOffset = m_foffset+m_totalBitWidth*vOffset;
-    size_t lineOffset;
-    int minX, maxX;
-    unsigned int visibleLineCount = (target->height() / zoom)+1;
-    QBitArray* readBits;
-    QBitArray  tsBits((m_tsPixelWidth-1)*m_totalBitsPerPixel);
+//Renders the raster from line vOffset and pixel hOffset into target
+void RasterWidget::paintRaster(QImage* target, quint64 vOffset, quint64 hOffset, unsigned int zoom, QProgressDialog* dlg) {
+    RasterLayout current = layout();
+    unsigned int line, last, step;
+    unsigned int lineCount = (target->height()+zoom-1)/zoom;
+    quint64 ahead = 0;
+
+    if( dlg == 0 ) {
+        m_renderer.render(m_captureFile,current,target,vOffset,hOffset,zoom,0,lineCount);
+        return;
+    }
+
+    dlg->setMinimum(0);
+    dlg->setMaximum(lineCount);
+    dlg->setValue(0);
+
+    //Exports render a read ahead window at a time so progress, cancel
+    //and the read ahead keep up
+    step = (unsigned int)qMin((quint64)RENDER_EXPORT_LINES*m_renderer.threadCount(),
+                              qMax((quint64)1,(quint64)EXPORT_READAHEAD*8/qMax(m_totalBitWidth,(quint64)1)));
+    beginExport(vOffset);
+    for( line=0; line<lineCount; line=last ) {
+        last = line + qMin(step,lineCount-line);
+        dlg->setValue(line);
+        if( dlg->wasCanceled() ) {
+            break;
+        }
+        exportAhead(vOffset+line,vOffset+lineCount,&ahead);
+        m_renderer.render(m_captureFile,current,target,vOffset,hOffset,zoom,line,last);
+    }
+    endExport(vOffset+line);
+}
+
+//Formats written through QImage need the whole raster in memory.  It is
+//kept in RGB16 (half of RGB32) and rendered into it a RGB32 strip at a
+//time.
+void RasterWidget::saveImage(QString path, quint64 vOffset, quint64 hOffset, quint64 pixelWidth, quint64 lineCount, QProgressDialog* dlg) {
+    RasterLayout current = layout();
+    QImage target, strip;
+    QPainter painter;
+    quint64 line, last, step;
+    quint64 ahead = 0;
+
+    if( pixelWidth == 0 || lineCount == 0 ) {
+        return;
+    }
+    step = qMin((quint64)RENDER_EXPORT_LINES*m_renderer.threadCount(),
+                (quint64)EXPORT_READAHEAD*8/qMax(m_totalBitWidth,(quint64)1));
+    step = qMax((quint64)1,qMin(step,(quint64)EXPORT_STRIP_BYTES/(pixelWidth*4)));
+    if( pixelWidth <= INT_MAX && lineCount <= INT_MAX ) {
+        target = QImage(QSize(pixelWidth,lineCount),QImage::Format_RGB16);
+        strip = QImage(QSize(pixelWidth,qMin(step,lineCount)),QImage::Format_RGB32);
+    }
+    if( target.isNull() || strip.isNull() ) {
+        QMessageBox::warning(this,"Save Raster","Not enough memory to render "+path+
+                             ".  PNG, TIFF and PPM files are written a strip at a time.");
+        return;
+    }
 
     if( dlg != 0 ) {
         dlg->setMinimum(0);
-        dlg->setMaximum(visibleLineCount);
+        dlg->setMaximum(PROGRESS_STEPS);
         dlg->setValue(0);
     }
 
-    QPainter painter;
-    painter.begin(target);
-
-    QBrush blackBrush(QColor(0,0,0,0xFF));
-    QBrush whiteBrush(QColor(0xFF,0xFF,0xFF,0xFF));
-    QBrush grayBrush(QColor(0x80,0x80,0x80,0xFF));
-    unsigned int maxRed   = m_rbpp==32?0xFFFFFFFF:(1<<m_rbpp)-1;
-    unsigned int maxGreen = m_gbpp==32?0xFFFFFFFF:(1<<m_gbpp)-1;
-    unsigned int maxBlue  = m_bbpp==32?0xFFFFFFFF:(1<<m_bbpp)-1;
-    unsigned int red;
-    unsigned int green;
-    unsigned int blue;
-    QBrush pixelBrush(QColor(0,0xFF,0,0xFF));
-
-    painter.fillRect(0,0,target->width(),target->height(),grayBrush);
-
-    if( m_captureFile ){
-        //Draw white lines to seperate timeslots
-        for( ts=1; ts<m_ts; ts++ ) {
-            x = (ts*m_tsPixelWidth-1-hOffset)*zoom;
-            if( x < 0 ) { continue; }
-            if( x >= target->width() ) { break; }
-            painter.fillRect(x,0,zoom,target->height(),whiteBrush);
-        }
-        //Draw pixels (with zoom)
-        for( line=0; line<visibleLineCount; line++ ) {
-            if( dlg != 0 ) {
-                dlg->setValue(line);
-                if( dlg->wasCanceled() ) {
-                    break;
-                }
-            }
-            y = line*zoom;
-            lineOffset = baseFileOffset + line*m_totalBitWidth;
-            if( lineOffset > m_captureFile->sizebit() ) {
-                painter.fillRect(0,y,target->width(),target->height()-y,grayBrush);
+    beginExport(vOffset);
+    painter.begin(&target);
+    for( line=0; line<lineCount; line=last ) {
+        last = line + qMin(step,lineCount-line);
+        if( dlg != 0 ) {
+            dlg->setValue(progressValue(line,lineCount));
+            if( dlg->wasCanceled() ) {
                 break;
             }
+        }
+        exportAhead(vOffset+line,vOffset+lineCount,&ahead);
+        m_renderer.render(m_captureFile,current,&strip,vOffset+line,hOffset,1,0,last-line);
+        painter.drawImage(QRect(0,line,pixelWidth,last-line),strip,QRect(0,0,pixelWidth,last-line));
+    }
+    painter.end();
+    endExport(vOffset+line);
+    if( ! target.save(path) ) {
+        QMessageBox::warning(this,"Save Raster","Could not write "+path);
+    }
+}
 
-            for( ts=0; ts<m_ts; ts++ ) {
-                minX = ( ( ts   * m_tsPixelWidth) - hOffset     )*zoom;
-                maxX = ( ((ts+1)* m_tsPixelWidth) - hOffset - 2 )*zoom;
-                if( maxX < 0 ) { continue; }
-                else if( minX >= target->width() ) { break; }
-                x = ((ts*m_tsPixelWidth) - hOffset)*zoom;
-
-                //Make tsBits big enough to generate all of the pixel for a time slot
-                //if the bpp needed is more than the bit represented then we will fill
-                //with extra zeros.
-                bitOffset = 0;
-                for( frame=0; frame<m_fpl; frame++ ) {
-                    m_captureFile->seekbit(lineOffset + m_ts*m_bpts*frame + ts*m_bpts);
-                    readBits = m_captureFile->readbit(m_bpts);
-                    for( bit=0; bit<m_bpts; bit++ ) {
-                        tsBits.setBit(bitOffset++,readBits->testBit(bit));
-                    }
-                    delete readBits;
-                }
-                while( bitOffset < tsBits.size() ) {
-                    tsBits.setBit(bitOffset++,false);
-                }
+//Renders the view as shown while zoomed out into target, a tile at a time
+//from the tile cache or the overview.  Tiles the overview has not got to
+//yet are waited for, with a dialog that can cancel the wait (one of its
+//own if dlg is 0).
+void RasterWidget::paintOverview(QImage* target, QProgressDialog* dlg) {
+    RasterLayout current = layout();
+    QPainter painter;
+    quint64 firstRow, lastRow, firstColumn, lastColumn;
+    quint64 row, column;
+    quint64 vOffset = m_voffset/m_shrink;
+    quint64 hOffset = m_hoffset/m_shrink;
+    int x, y;
+    int done = 0;
+    bool cancelled = false;
+    QProgressDialog* own = 0;
+    QImage tile;
 
-                x = minX;
-                bitOffset = 0;
-                for( pixel=0; pixel<m_tsPixelWidth-1; pixel++, x=x+zoom ) {
-                    if( x < 0 ) { bitOffset=bitOffset+m_totalBitsPerPixel; continue; }
-                    else if( x >= target->width() ) { break; }
-                    red = 0;
-                    for( bit=0; bit<m_rbpp; bit++ ) {
-                        red = (red<<1) | tsBits.testBit(bitOffset++);
-                    }
-                    if( red ) {
-                        red = (unsigned int)( ((double)red / (double)maxRed)*255 ) & 0xFF;
-                    }
-                    green = 0;
-                    for( bit=0; bit<m_gbpp; bit++ ) {
-                        green = (green<<1) | tsBits.testBit(bitOffset++);
-                    }
-                    if( green ) {
-                        green = (unsigned int)( ((double)green / (double)maxGreen)*255 ) & 0xFF;
-                    }
-                    blue = 0;
-                    for( bit=0; bit<m_bbpp; bit++ ) {
-                        blue = (blue<<1) | tsBits.testBit(bitOffset++);
-                    }
-                    if( blue ) {
-                        blue = (unsigned int)( ((double)blue / (double)maxBlue)*255 ) & 0xFF;
+    target->fill(qRgb(0x80,0x80,0x80));
+    if( m_captureFile == 0 || target->width() == 0 || target->height() == 0 ) {
+        return;
+    }
+    if( dlg == 0 ) {
+        own = new QProgressDialog("Waiting for the overview","Cancel",0,100,this);
+        own->setWindowModality(Qt::WindowModal);
+        dlg = own;
+    }
+    m_overview->setLayout(current);
+    firstRow = vOffset/TILECACHE_TILE_SIZE;
+    lastRow = (vOffset + target->height()-1)/TILECACHE_TILE_SIZE;
+    firstColumn = hOffset/TILECACHE_TILE_SIZE;
+    lastColumn = (hOffset + target->width()-1)/TILECACHE_TILE_SIZE;
+
+    dlg->setMinimum(0);
+    dlg->setMaximum((lastRow-firstRow+1)*(lastColumn-firstColumn+1));
+    dlg->setValue(0);
+
+    painter.begin(target);
+    for( row=firstRow; row<=lastRow && !cancelled; row++ ) {
+        for( column=firstColumn; column<=lastColumn && !cancelled; column++ ) {
+            tile = m_tiles.lookup(tileKey(row,column));
+            if( tile.isNull() ) {
+                tile = QImage(QSize(TILECACHE_TILE_SIZE,TILECACHE_TILE_SIZE),QImage::Format_RGB32);
+                while( !m_overview->render(m_captureFile,current,&tile,row*TILECACHE_TILE_SIZE,
+                                           column*TILECACHE_TILE_SIZE,m_shrink) ) {
+                    QApplication::processEvents();
+                    if( dlg->wasCanceled() ) {
+                        cancelled = true;
+                        break;
                     }
-                    pixelBrush.setColor(QColor(red,green,blue,0xFF));
-                    painter.fillRect(x,y,zoom,zoom,pixelBrush);
+                    QThread::msleep(OVERVIEW_POLL_MS);
                 }
             }
+            if( !cancelled ) {
+                x = (qint64)(column*TILECACHE_TILE_SIZE) - (qint64)hOffset;
+                y = (qint64)(row*TILECACHE_TILE_SIZE) - (qint64)vOffset;
+                painter.drawImage(x,y,tile);
+            }
+            dlg->setValue(++done);
         }
     }
     painter.end();
+    delete own;
+}
+
+//Renders lineCount lines from line vOffset and pixel hOffset a strip at a
+//time, handing each strip to the writer before rendering the next
+void RasterWidget::streamRaster(QString path, quint64 vOffset, quint64 hOffset, quint64 pixelWidth, quint64 lineCount, QProgressDialog* dlg) {
+    RasterLayout current = layout();
+    RasterWriter* writer;
+    QImage strip;
+    quint64 line, last, step;
+    quint64 ahead = 0;
+    bool ok = true;
+    bool cancelled = false;
+
+    writer = RasterWriter::create(path,qMin(pixelWidth,(quint64)INT_MAX),lineCount);
+    if( writer == 0 ) {
+        QMessageBox::warning(this,"Save Raster","Could not create "+path);
+        return;
+    }
+    if( writer->width() < pixelWidth || writer->height() < lineCount ) {
+        //Rather than a cut off image
+        delete writer;
+        QFile::remove(path);
+        QMessageBox::warning(this,"Save Raster",QString("The raster is %1 x %2 pixels, more than %3 can hold.%4")
+                             .arg(pixelWidth).arg(lineCount).arg(path)
+                             .arg(path.endsWith(".ppm",Qt::CaseInsensitive) ? "" : "  PPM files hold any number of lines."));
+        return;
+    }
+    step = qMin((quint64)RENDER_EXPORT_LINES*m_renderer.threadCount(),
+                (quint64)EXPORT_READAHEAD*8/qMax(m_totalBitWidth,(quint64)1));
+    step = qMax((quint64)1,qMin(step,(quint64)EXPORT_STRIP_BYTES/(pixelWidth*4)));
+    strip = QImage(QSize(pixelWidth,qMin(step,lineCount)),QImage::Format_RGB32);
+    if( strip.isNull() ) {
+        delete writer;
+        QFile::remove(path);
+        QMessageBox::warning(this,"Save Raster","Not enough memory to render "+path);
+        return;
+    }
+
+    if( dlg != 0 ) {
+        dlg->setMinimum(0);
+        dlg->setMaximum(PROGRESS_STEPS);
+        dlg->setValue(0);
+    }
+
+    beginExport(vOffset);
+    for( line=0; line<lineCount; line=last ) {
+        last = line + qMin(step,lineCount-line);
+        if( dlg != 0 ) {
+            dlg->setValue(progressValue(line,lineCount));
+            if( dlg->wasCanceled() ) {
+                cancelled = true;
+                break;
+            }
+        }
+        exportAhead(vOffset+line,vOffset+lineCount,&ahead);
+        m_renderer.render(m_captureFile,current,&strip,vOffset+line,hOffset,1,0,last-line);
+        if( ! writer->write(strip,0,last-line) ) {
+            ok = false;
+            break;
+        }
+    }
+    endExport(vOffset+line);
+    ok = ok && ! cancelled && writer->finish();
+    delete writer;
+    //The image size is in the header, a cancelled export can't be cut short
+    if( ! ok ) {
+        QFile::remove(path);
+    }
+    if( ! ok && ! cancelled ) {
+        QMessageBox::warning(this,"Save Raster","Could not write "+path);
+    }
 }
 
 void RasterWidget::saveHorizontalCSV(QString path, QBitArray *tsIncl, QProgressDialog* dlg) {
-    saveCSV(path,tsIncl,m_hoffset,height()/m_zoom,dlg);
+    saveCSV(path,tsIncl,m_voffset,viewLines(),dlg);
 }
 
 void RasterWidget::saveEntireCSV(QString path, QBitArray *tsIncl, QProgressDialog* dlg) {
     saveCSV(path,tsIncl,0,m_totalPixelHeight,dlg);
 }
 
-void RasterWidget::saveCSV(QString path, QBitArray *tsIncl, size_t lineOffset, size_t lineCount, QProgressDialog* dlg) {
+void RasterWidget::saveCSV(QString path, QBitArray *tsIncl, quint64 lineOffset, quint64 lineCount, QProgressDialog* dlg) {
     QFile outFile(path);
     outFile.open(QFile::WriteOnly | QFile::Truncate);
-    QTextStream out(&outFile);
+    QByteArray out;
     QBitArray allYes(m_ts,true);
-    size_t fileLineOffset;
-    unsigned int line,frame,ts;
+    quint64 fileLineOffset;
+    quint64 line;
+    unsigned int ts;
     int i;
 
     if( ! outFile.isOpen() ) {
@@ -359,9 +952,9 @@ void RasterWidget::saveCSV(QString path, QBitArray *tsIncl, size_t lineOffset, s
     }
 
     if( dlg != 0 ) {
-        dlg->setMinimum(lineOffset);
-        dlg->setMaximum(lineOffset+lineCount);
-        dlg->setValue(lineOffset);
+        dlg->setMinimum(0);
+        dlg->setMaximum(PROGRESS_STEPS);
+        dlg->setValue(0);
     }
 
     if( tsIncl == 0 ) {
@@ -371,113 +964,123 @@ void RasterWidget::saveCSV(QString path, QBitArray *tsIncl, size_t lineOffset, s
     bool first = true;
     for( i=0; i<(int)m_ts; i++ ) {
         if( tsIncl->testBit(i) ) {
-            if( ! first ) { out << ","; }
+            if( ! first ) { out.append(','); }
             else { first = false; }
-            out<<"TS:"<<i;
+            out.append("TS:").append(QByteArray::number(i));
         }
     }
-    out << "\n";
+    out.append('\n');
 
-    QBitArray data(m_bpts*m_fpl);
-    QBitArray *bits;
+    //Text is collected and written in large pieces rather than a
+    //character at a time
+    out.reserve(EXPORT_WRITE_BUFFER+m_totalBitWidth+m_ts+1);
+    QVector<quint64> data(BitKernels::wordCount(m_bpts*m_fpl));
+    QVector<quint64> lineBits(BitKernels::wordCount(m_totalBitWidth));
+    quint64 ahead = 0;
+    beginExport(lineOffset);
     for( line=lineOffset; line<lineOffset+lineCount && line<m_totalPixelHeight; line++ ) {
         if( dlg != 0 ) {
-            dlg->setValue(line);
+            dlg->setValue(progressValue(line-lineOffset,lineCount));
             if( dlg->wasCanceled() ) {
                 break;
             }
         }
+        exportAhead(line,lineOffset+lineCount,&ahead);
         fileLineOffset = m_foffset + line*m_totalBitWidth;
+        m_captureFile->extractbits(fileLineOffset,m_totalBitWidth,lineBits.data());
         first = true;
         for( ts=0; ts<m_ts; ts++ ) {
             if( ! tsIncl->testBit(ts) ) {
                 continue;
             }
-            data.fill(false);
-            for( frame=0; frame<m_fpl; frame++ ) {
-                 m_captureFile->seekbit(fileLineOffset + frame*m_frameBitWidth + ts*m_bpts );
-                 bits = m_captureFile->readbit(m_bpts);
-                 for( i=0; i<bits->size(); i++ ) {
-                     data.setBit(frame*m_bpts+i,bits->testBit(i));
-                 }
-                 delete bits;
-            }
-            if( ! first ) { out << ","; }
+            BitKernels::gatherBits(data.data(),lineBits.constData(),ts*m_bpts,m_frameBitWidth,m_bpts,m_fpl);
+            if( ! first ) { out.append(','); }
             else { first = false; }
-            for( i=0; i<data.size(); i++ ) {
-                if( data.testBit(i) ) {
-                    out << "1";
+            for( i=0; i<(int)(m_bpts*m_fpl); i++ ) {
+                if( BitKernels::testBit(data.constData(),i) ) {
+                    out.append('1');
                 }
                 else {
-                    out << "0";
+                    out.append('0');
                 }
             }
         }
-        out << "\n";
+        out.append('\n');
+        if( out.size() >= EXPORT_WRITE_BUFFER ) {
+            outFile.write(out);
+            out.resize(0);
+        }
     }
+    endExport(line);
+    outFile.write(out);
 }
 
 void RasterWidget::saveHorizontalTimeSlots(QString path, QBitArray *tsIncl, QProgressDialog* dlg) {
-    saveTimeSlots(path,tsIncl,m_hoffset,height()/m_zoom,dlg);
+    saveTimeSlots(path,tsIncl,m_voffset,viewLines(),dlg);
 }
 
 void RasterWidget::saveEntireTimeSlots(QString path, QBitArray *tsIncl, QProgressDialog* dlg) {
     saveTimeSlots(path,tsIncl,0,m_totalPixelHeight,dlg);
 }
 
-void RasterWidget::saveTimeSlots(QString path, QBitArray *tsIncl, size_t lineOffset, size_t lineCount, QProgressDialog* dlg) {
+void RasterWidget::saveTimeSlots(QString path, QBitArray *tsIncl, quint64 lineOffset, quint64 lineCount, QProgressDialog* dlg) {
     FILE* fp;
     unsigned char databyte = 0;
     size_t databytelen = 0;
     QBitArray allYes(m_ts,true);
-    unsigned int line,frame,ts;
+    quint64 line;
+    unsigned int frame,ts;
     int i;
 
     fp = fopen(path.toStdString().c_str(),"wb");
     if( ! fp ) {
         return;
     }
+    setvbuf(fp,0,_IOFBF,EXPORT_WRITE_BUFFER);
 
     if( dlg != 0 ) {
-        dlg->setMinimum(lineOffset);
-        dlg->setMaximum(lineOffset+lineCount);
-        dlg->setValue(lineOffset);
+        dlg->setMinimum(0);
+        dlg->setMaximum(PROGRESS_STEPS);
+        dlg->setValue(0);
     }
 
     if( tsIncl == 0 ) {
         tsIncl = &allYes;
     }
 
-    QBitArray *bits;
+    QVector<quint64> lineBits(BitKernels::wordCount(m_totalBitWidth));
+    size_t fieldOffset;
+    quint64 ahead = 0;
+    beginExport(lineOffset);
     for( line=lineOffset; line<lineOffset+lineCount && line<m_totalPixelHeight; line++ ) {
         if( dlg != 0 ) {
-            dlg->setValue(line);
+            dlg->setValue(progressValue(line-lineOffset,lineCount));
             if( dlg->wasCanceled() ) {
                 break;
             }
         }
-        lineOffset = m_foffset + line*m_totalBitWidth;
+        exportAhead(line,lineOffset+lineCount,&ahead);
+        m_captureFile->extractbits(m_foffset + line*m_totalBitWidth,m_totalBitWidth,lineBits.data());
         for( frame=0; frame<m_fpl; frame++ ) {
             for( ts=0; ts<m_ts; ts++ ) {
                 if( ! tsIncl->testBit(ts) ) {
                     continue;
                 }
-                m_captureFile->seekbit(lineOffset + frame*m_frameBitWidth + ts*m_bpts );
-                bits = m_captureFile->readbit(m_bpts);
-                for( i=0; i<bits->size(); i++ ) {
-                    if( bits->testBit(i) ) {
+                fieldOffset = frame*m_frameBitWidth + ts*m_bpts;
+                for( i=0; i<(int)m_bpts; i++ ) {
+                    if( BitKernels::testBit(lineBits.constData(),fieldOffset+i) ) {
                         databyte = databyte | (1<<(7-databytelen));
                     }
                     databytelen++;
                     if( databytelen == 8 ) {
-                        fwrite(&databyte,1,1,fp);
+                        putc(databyte,fp);
                         databyte = 0;
                         databytelen = 0;
                     }
                 }
-                delete bits;
             }
         }
     }
+    endExport(line);
     fclose(fp);
 }
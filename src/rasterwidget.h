@@ -30,22 +30,44 @@
 #include <QString>
 #include <QBitArray>
 #include <QProgressDialog>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QRect>
+#include <QImage>
 #include "capturefile.h"
+#include "readahead.h"
+#include "tilecache.h"
+#include "rasterrenderer.h"
+#include "tilerenderer.h"
+#include "overview.h"
 
 class RasterWidget : public QWidget
 {
     Q_OBJECT
 public:
     explicit RasterWidget(QWidget *parent = 0);
+    ~RasterWidget();
     void setCaptureFile(CaptureFile* captureFile);
     void setTimeSlots(unsigned int ts);
     void setBitsPerTimeSlot(unsigned int bpts);
     void setFramesPerLine(unsigned int fpl);
-    void setFileOffset(unsigned int offset);
+    void setFileOffset(quint64 offset);
     void setZoom(unsigned int zoom);
+    void setShrink(unsigned int shrink);
     void setBitsPerPixels(unsigned int rbpp, unsigned int gbpp, unsigned int bbpp);
-    unsigned int horizontalMaximum();
-    unsigned int verticalMaximum();
+    //Sets the capture's transform and redraws everything read through it
+    void setTransform(BitTransform transform);
+    quint64 horizontalMaximum();
+    quint64 verticalMaximum();
+    quint64 verticalOffset();
+    //Picks up lines appended to the capture, repainting only those.  With
+    //autoScroll the newest complete lines stay in view.
+    void captureGrown(bool autoScroll);
+    //Starts reading the screen at vertical offset in the background
+    void readAheadTo(quint64 offset);
+    //Exports read the capture around the page cache where possible
+    void setDirectExport(bool direct);
+    TileCache* tileCache();
 
     void saveViewableRaster(QString path, QProgressDialog* dlg = 0);
     void saveHorizontalRaster(QString path, QProgressDialog* dlg = 0);
@@ -62,9 +84,13 @@ signals:
     void info(QString label,QString data);
 
 public slots:
-    void setHorizontalOffset(int offset);
-    void setVerticalOffset(int offset);
+    void setHorizontalOffset(quint64 offset);
+    void setVerticalOffset(quint64 offset);
 
+private slots:
+    void tileReady(quint64 row, quint64 column);
+    void redraw();
+    void overviewProgress();
 
 protected:
     virtual void mouseMoveEvent(QMouseEvent* event);
@@ -76,26 +102,59 @@ private:
     unsigned int m_ts;      //Number of time slots
     unsigned int m_bpts;    //Bits per time slot
     unsigned int m_fpl;     //Frames per line
-    unsigned int m_foffset; //File offset
+    quint64 m_foffset;      //File offset
     unsigned int m_zoom;
+    unsigned int m_shrink;  //Raster pixels per view pixel when zoomed out
     unsigned int m_rbpp;    //Red bits per pixel
     unsigned int m_gbpp;    //Green bits per pixel
     unsigned int m_bbpp;    //Blue bits per pixel
-    unsigned int m_hoffset;
-    unsigned int m_voffset;
+    quint64 m_hoffset;
+    quint64 m_voffset;
 
-    unsigned int m_totalBitWidth;     //Total bits represented per line
-    unsigned int m_tsBitWidth;        //Total bits represented in a single timeslot per line
-    unsigned int m_frameBitWidth;     //Total bits that represent a single frame in the file
+    quint64 m_totalBitWidth;          //Total bits represented per line
+    quint64 m_tsBitWidth;             //Total bits represented in a single timeslot per line
+    quint64 m_frameBitWidth;          //Total bits that represent a single frame in the file
     unsigned int m_totalBitsPerPixel; //Total number of bits represented by each pixel
-    unsigned int m_tsPixelWidth;      //Total pixels needed to represent each timeslot (with 1 for a buffer)
-    unsigned int m_totalPixelWidth;   //Total pixels per line
-    unsigned int m_totalPixelHeight;  //Total lines
+    quint64 m_tsPixelWidth;           //Total pixels needed to represent each timeslot (with 1 for a buffer)
+    quint64 m_totalPixelWidth;        //Total pixels per line
+    quint64 m_totalPixelHeight;       //Total lines
+
+    ReadAhead* m_readAhead;
+    RasterRenderer m_renderer;        //Exports render on the calling thread
+    TileCache m_tiles;
+    Overview* m_overview;             //Zoomed out views come from here
+    TileRenderer* m_tileRenderer;     //The view renders in the background
+    QImage m_frame;                   //What the widget last showed
+    QTimer* m_invalidateTimer;
+    QElapsedTimer m_frameTimer;       //Since the last full redraw
+    QElapsedTimer m_scrollTimer;
+    double m_scrollVelocity;          //Lines per second, negative when scrolling up
+    bool m_directExport;
+    quint64 m_exportReleased;         //Lines before this an export is done with
 
     void calculateSizes();
-    void paintRaster(QPaintDevice* target, size_t vOffset, size_t hOffset, size_t zoom, QProgressDialog* dlg = 0);
-    void saveCSV(QString path, QBitArray *tsIncl, size_t lineOffset, size_t lineCount, QProgressDialog* dlg = 0);
-    void saveTimeSlots(QString path, QBitArray *tsIncl, size_t lineOffset, size_t lineCount, QProgressDialog* dlg = 0);
+    void calculateHeight();
+    void invalidate();
+    RasterLayout layout();
+    qint64 toScreen(quint64 pixel, quint64 origin);
+    quint64 toRaster(int screen);
+    quint64 viewLines();
+    quint64 viewColumns();
+    TileKey tileKey(quint64 row, quint64 column);
+    void readAhead(quint64 oldOffset);
+    void scrollFrame(qint64 dx, qint64 dy);
+    void requestLines(quint64 first, quint64 count);
+    void beginExport(quint64 firstLine);
+    void exportAhead(quint64 line, quint64 lastLine, quint64* next);
+    void endExport(quint64 line);
+    void keepLines(quint64* first, quint64* last);
+    void releaseLines(quint64 first, quint64 last);
+    void paintRaster(QImage* target, quint64 vOffset, quint64 hOffset, unsigned int zoom, QProgressDialog* dlg = 0);
+    void paintOverview(QImage* target, QProgressDialog* dlg = 0);
+    void saveImage(QString path, quint64 vOffset, quint64 hOffset, quint64 pixelWidth, quint64 lineCount, QProgressDialog* dlg = 0);
+    void streamRaster(QString path, quint64 vOffset, quint64 hOffset, quint64 pixelWidth, quint64 lineCount, QProgressDialog* dlg = 0);
+    void saveCSV(QString path, QBitArray *tsIncl, quint64 lineOffset, quint64 lineCount, QProgressDialog* dlg = 0);
+    void saveTimeSlots(QString path, QBitArray *tsIncl, quint64 lineOffset, quint64 lineCount, QProgressDialog* dlg = 0);
 };
 
 #endif // RASTERWIDGET_H
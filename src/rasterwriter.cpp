@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rasterwriter.h"
+#include <stdio.h>
+#include <vector>
+#ifdef TDM_HAVE_PNG
+#include <png.h>
+#include <setjmp.h>
+#endif
+#ifdef TDM_HAVE_TIFF
+#include <tiffio.h>
+#endif
+
+//Uncompressed size past which TIFFs are written as BigTIFF, classic TIFF
+//offsets stop at 4 GB
+#define RASTERWRITER_BIGTIFF 0xF0000000ULL
+
+RasterWriter::RasterWriter(quint64 width, quint64 height) {
+    m_width = width;
+    m_height = height;
+    m_written = 0;
+}
+
+RasterWriter::~RasterWriter() {
+}
+
+quint64 RasterWriter::width() const {
+    return m_width;
+}
+
+quint64 RasterWriter::height() const {
+    return m_height;
+}
+
+void RasterWriter::packRow(const QImage& image, int row, unsigned char* out) const {
+    const QRgb* in = (const QRgb*)image.constScanLine(row);
+    quint64 i;
+    for( i=0; i<m_width; i++ ) {
+        out[0] = qRed(in[i]);
+        out[1] = qGreen(in[i]);
+        out[2] = qBlue(in[i]);
+        out += 3;
+    }
+}
+
+//Binary PPM, a header and then the bare pixels
+class RasterWriter_PPM: public RasterWriter
+{
+public:
+    RasterWriter_PPM(QString path, quint64 width, quint64 height): RasterWriter(width,height) {
+        m_fp = fopen(path.toStdString().c_str(),"wb");
+        if( m_fp ) {
+            setvbuf(m_fp,0,_IOFBF,RASTERWRITER_BUFFER);
+            fprintf(m_fp,"P6\n%llu %llu\n255\n",(unsigned long long)m_width,(unsigned long long)m_height);
+            m_row.resize(m_width*3);
+        }
+    }
+    virtual ~RasterWriter_PPM() {
+        if( m_fp ) {
+            fclose(m_fp);
+        }
+    }
+    bool isOk() {
+        return m_fp != 0;
+    }
+    virtual bool write(const QImage& image, int first, int last) {
+        int row;
+        for( row=first; row<last && m_written<m_height; row++ ) {
+            packRow(image,row,m_row.data());
+            if( fwrite(m_row.data(),1,m_row.size(),m_fp) != m_row.size() ) {
+                return false;
+            }
+            m_written++;
+        }
+        return true;
+    }
+    virtual bool finish() {
+        bool ok = m_written == m_height && fflush(m_fp) == 0 && ferror(m_fp) == 0;
+        ok = fclose(m_fp) == 0 && ok;
+        m_fp = 0;
+        return ok;
+    }
+
+private:
+    FILE* m_fp;
+    std::vector<unsigned char> m_row;
+};
+
+#ifdef TDM_HAVE_PNG
+//libpng reports errors by longjmp() back into whichever call set it up,
+//so every call into it sets the jump first
+class RasterWriter_PNG: public RasterWriter
+{
+public:
+    RasterWriter_PNG(QString path, quint64 width, quint64 height):
+        RasterWriter(width,qMin(height,(quint64)PNG_UINT_31_MAX)) {
+        m_png = 0;
+        m_info = 0;
+        m_fp = fopen(path.toStdString().c_str(),"wb");
+        if( m_fp == 0 ) {
+            return;
+        }
+        setvbuf(m_fp,0,_IOFBF,RASTERWRITER_BUFFER);
+        m_png = png_create_write_struct(PNG_LIBPNG_VER_STRING,0,0,0);
+        if( m_png ) {
+            m_info = png_create_info_struct(m_png);
+        }
+        if( m_info == 0 || setjmp(png_jmpbuf(m_png)) ) {
+            close();
+            return;
+        }
+        png_init_io(m_png,m_fp);
+        //libpng refuses images over a million pixels on a side by default
+        png_set_user_limits(m_png,PNG_UINT_31_MAX,PNG_UINT_31_MAX);
+        png_set_IHDR(m_png,m_info,(png_uint_32)m_width,(png_uint_32)m_height,8,PNG_COLOR_TYPE_RGB,
+                     PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+        png_write_info(m_png,m_info);
+        //Rows go in as QImage RGB32 scan lines, libpng drops the unused byte
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        png_set_bgr(m_png);
+        png_set_filler(m_png,0,PNG_FILLER_AFTER);
+#else
+        png_set_filler(m_png,0,PNG_FILLER_BEFORE);
+#endif
+    }
+    virtual ~RasterWriter_PNG() {
+        close();
+    }
+    bool isOk() {
+        return m_png != 0;
+    }
+    virtual bool write(const QImage& image, int first, int last) {
+        //Volatile so the count survives a longjmp()
+        volatile int row = first;
+        if( setjmp(png_jmpbuf(m_png)) ) {
+            return false;
+        }
+        for( ; row<last && m_written<m_height; row++ ) {
+            png_write_row(m_png,(png_const_bytep)image.constScanLine(row));
+            m_written++;
+        }
+        return true;
+    }
+    virtual bool finish() {
+        bool ok = m_written == m_height;
+        if( ok ) {
+            if( setjmp(png_jmpbuf(m_png)) ) {
+                ok = false;
+            }
+            else {
+                png_write_end(m_png,0);
+            }
+        }
+        ok = close() && ok;
+        return ok;
+    }
+
+private:
+    bool close() {
+        bool ok = true;
+        if( m_png ) {
+            png_destroy_write_struct(&m_png,m_info ? &m_info : 0);
+            m_png = 0;
+            m_info = 0;
+        }
+        if( m_fp ) {
+            ok = fclose(m_fp) == 0;
+            m_fp = 0;
+        }
+        return ok;
+    }
+
+    FILE* m_fp;
+    png_structp m_png;
+    png_infop m_info;
+};
+#endif
+
+#ifdef TDM_HAVE_TIFF
+class RasterWriter_TIFF: public RasterWriter
+{
+public:
+    RasterWriter_TIFF(QString path, quint64 width, quint64 height):
+        RasterWriter(width,qMin(height,(quint64)0xFFFFFFFFU)) {
+        bool big = m_width*m_height*3 >= RASTERWRITER_BIGTIFF;
+        m_tif = TIFFOpen(path.toStdString().c_str(),big ? "w8" : "w");
+        if( m_tif == 0 ) {
+            return;
+        }
+        TIFFSetField(m_tif,TIFFTAG_IMAGEWIDTH,(uint32_t)m_width);
+        TIFFSetField(m_tif,TIFFTAG_IMAGELENGTH,(uint32_t)m_height);
+        TIFFSetField(m_tif,TIFFTAG_BITSPERSAMPLE,8);
+        TIFFSetField(m_tif,TIFFTAG_SAMPLESPERPIXEL,3);
+        TIFFSetField(m_tif,TIFFTAG_PHOTOMETRIC,PHOTOMETRIC_RGB);
+        TIFFSetField(m_tif,TIFFTAG_PLANARCONFIG,PLANARCONFIG_CONTIG);
+        TIFFSetField(m_tif,TIFFTAG_COMPRESSION,COMPRESSION_LZW);
+        TIFFSetField(m_tif,TIFFTAG_ROWSPERSTRIP,TIFFDefaultStripSize(m_tif,0));
+        m_row.resize(m_width*3);
+    }
+    virtual ~RasterWriter_TIFF() {
+        if( m_tif ) {
+            TIFFClose(m_tif);
+        }
+    }
+    bool isOk() {
+        return m_tif != 0;
+    }
+    virtual bool write(const QImage& image, int first, int last) {
+        int row;
+        for( row=first; row<last && m_written<m_height; row++ ) {
+            packRow(image,row,m_row.data());
+            if( TIFFWriteScanline(m_tif,m_row.data(),(uint32_t)m_written,0) < 0 ) {
+                return false;
+            }
+            m_written++;
+        }
+        return true;
+    }
+    virtual bool finish() {
+        bool ok = m_written == m_height && TIFFFlush(m_tif) == 1;
+        TIFFClose(m_tif);
+        m_tif = 0;
+        return ok;
+    }
+
+private:
+    TIFF* m_tif;
+    std::vector<unsigned char> m_row;
+};
+#endif
+
+bool RasterWriter::canWrite(QString path) {
+#ifdef TDM_HAVE_PNG
+    if( path.endsWith(".png",Qt::CaseInsensitive) ) {
+        return true;
+    }
+#endif
+#ifdef TDM_HAVE_TIFF
+    if( path.endsWith(".tif",Qt::CaseInsensitive) || path.endsWith(".tiff",Qt::CaseInsensitive) ) {
+        return true;
+    }
+#endif
+    return path.endsWith(".ppm",Qt::CaseInsensitive) || path.endsWith(".pnm",Qt::CaseInsensitive);
+}
+
+RasterWriter* RasterWriter::create(QString path, quint64 width, quint64 height) {
+    if( width == 0 || height == 0 || ! canWrite(path) ) {
+        return 0;
+    }
+#ifdef TDM_HAVE_PNG
+    if( path.endsWith(".png",Qt::CaseInsensitive) ) {
+        RasterWriter_PNG* png = new RasterWriter_PNG(path,width,height);
+        if( png->isOk() ) {
+            return png;
+        }
+        delete png;
+        return 0;
+    }
+#endif
+#ifdef TDM_HAVE_TIFF
+    if( path.endsWith(".tif",Qt::CaseInsensitive) || path.endsWith(".tiff",Qt::CaseInsensitive) ) {
+        RasterWriter_TIFF* tif = new RasterWriter_TIFF(path,width,height);
+        if( tif->isOk() ) {
+            return tif;
+        }
+        delete tif;
+        return 0;
+    }
+#endif
+    RasterWriter_PPM* ppm = new RasterWriter_PPM(path,width,height);
+    if( ppm->isOk() ) {
+        return ppm;
+    }
+    delete ppm;
+    return 0;
+}
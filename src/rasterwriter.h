@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RASTERWRITER_H
+#define RASTERWRITER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QImage>
+
+//Bytes of encoded image the writers collect before writing them out
+#define RASTERWRITER_BUFFER (4*1024*1024)
+
+//Writes an image to a file a few rows at a time, top to bottom, so
+//rasters far larger than memory can be saved.  The format comes from the
+//file name: .png (with libpng, TDM_HAVE_PNG), .tif/.tiff (with libtiff,
+//TDM_HAVE_TIFF) and .ppm/.pnm.
+class RasterWriter
+{
+public:
+    //Returns 0 if the format is not one of the above or the file can't be
+    //created
+    static RasterWriter* create(QString path, quint64 width, quint64 height);
+    //Whether create() knows the format of path
+    static bool canWrite(QString path);
+    //Deleting a writer before finish() leaves an incomplete file
+    virtual ~RasterWriter();
+    //The format can hold fewer rows than asked for, rows past height()
+    //are dropped
+    quint64 width() const;
+    quint64 height() const;
+    //Appends rows first to last of an RGB32 image at least width() wide
+    virtual bool write(const QImage& image, int first, int last) = 0;
+    virtual bool finish() = 0;
+
+protected:
+    RasterWriter(quint64 width, quint64 height);
+    //Packs an RGB32 scan line into 8 bit RGB triplets
+    void packRow(const QImage& image, int row, unsigned char* out) const;
+    quint64 m_width;
+    quint64 m_height;
+    quint64 m_written;      //Rows written so far
+};
+
+#endif // RASTERWRITER_H
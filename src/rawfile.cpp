@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rawfile.h"
+#include <string.h>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+RawFile::RawFile() {
+#ifdef Q_OS_WIN
+    m_handle = INVALID_HANDLE_VALUE;
+#else
+    m_fd = -1;
+#endif
+}
+
+RawFile::~RawFile() {
+    close();
+}
+
+bool RawFile::open(QString path, bool direct) {
+    close();
+#ifdef Q_OS_WIN
+    //Writers of a capture being followed must still be able to append
+    m_handle = CreateFileW((const wchar_t*)path.utf16(),GENERIC_READ,FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+                           0,OPEN_EXISTING,direct ? FILE_FLAG_NO_BUFFERING : FILE_ATTRIBUTE_NORMAL,0);
+#else
+    int flags = O_RDONLY;
+#ifdef O_DIRECT
+    if( direct ) {
+        flags = flags | O_DIRECT;
+    }
+#endif
+    m_fd = ::open(path.toStdString().c_str(),flags);
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if( direct && m_fd >= 0 ) {
+        fcntl(m_fd,F_NOCACHE,1);
+    }
+#endif
+#endif
+    return isOpen();
+}
+
+void RawFile::close() {
+#ifdef Q_OS_WIN
+    if( m_handle != INVALID_HANDLE_VALUE ) {
+        CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if( m_fd >= 0 ) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+}
+
+bool RawFile::isOpen() const {
+#ifdef Q_OS_WIN
+    return m_handle != INVALID_HANDLE_VALUE;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+quint64 RawFile::size() const {
+#ifdef Q_OS_WIN
+    LARGE_INTEGER size;
+    if( !isOpen() || !GetFileSizeEx(m_handle,&size) ) {
+        return 0;
+    }
+    return size.QuadPart;
+#else
+    struct stat st;
+    if( !isOpen() || fstat(m_fd,&st) != 0 ) {
+        return 0;
+    }
+    return st.st_size;
+#endif
+}
+
+void RawFile::adviseSequential(bool sequential) {
+#ifdef POSIX_FADV_SEQUENTIAL
+    if( isOpen() ) {
+        posix_fadvise(m_fd,0,0,sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_NORMAL);
+    }
+#else
+    Q_UNUSED(sequential);
+#endif
+}
+
+void RawFile::drop(quint64 pos, quint64 len) {
+#ifdef POSIX_FADV_DONTNEED
+    if( isOpen() ) {
+        posix_fadvise(m_fd,pos,len,POSIX_FADV_DONTNEED);
+    }
+#else
+    Q_UNUSED(pos);
+    Q_UNUSED(len);
+#endif
+}
+
+#ifndef Q_OS_WIN
+int RawFile::handle() const {
+    return m_fd;
+}
+#endif
+
+size_t RawFile::read(quint64 pos, size_t len, unsigned char* buf) const {
+    size_t done = 0;
+    if( !isOpen() ) {
+        return 0;
+    }
+    while( done < len ) {
+#ifdef Q_OS_WIN
+        OVERLAPPED overlapped;
+        DWORD got = 0;
+        memset(&overlapped,0,sizeof(overlapped));
+        overlapped.Offset = (DWORD)(pos+done);
+        overlapped.OffsetHigh = (DWORD)((pos+done) >> 32);
+        if( !ReadFile(m_handle,buf+done,(DWORD)qMin(len-done,(size_t)0x40000000),&got,&overlapped) || got == 0 ) {
+            break;
+        }
+#else
+        ssize_t got = pread(m_fd,buf+done,len-done,pos+done);
+        if( got < 0 && errno == EINTR ) {
+            continue;
+        }
+        if( got <= 0 ) {
+            break;
+        }
+#endif
+        done = done + got;
+    }
+    return done;
+}
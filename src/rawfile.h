@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RAWFILE_H
+#define RAWFILE_H
+
+#include<QString>
+#include<stddef.h>
+
+//Offset, length and buffer alignment direct (uncached) reads need
+#define RAWFILE_ALIGN 4096
+
+//A read only file read at explicit offsets (pread() on Unix, ReadFile()
+//with an OVERLAPPED offset on Windows).  There is no shared file position,
+//so any number of threads can read at once.
+class RawFile
+{
+public:
+    RawFile();
+    ~RawFile();
+    //direct bypasses the page cache (O_DIRECT), reads must then be
+    //RAWFILE_ALIGN aligned.  Fails where the file system does not allow it.
+    bool open(QString path, bool direct=false);
+    void close();
+    bool isOpen() const;
+    //Current size, picks up data appended since the file was opened
+    quint64 size() const;
+    //Reads up to len bytes at pos, returns how many were read (short only
+    //at the end of the file or on an error)
+    size_t read(quint64 pos, size_t len, unsigned char* buf) const;
+    //Hints that the file is about to be read front to back
+    void adviseSequential(bool sequential);
+    //Drops len bytes at pos from the page cache, they will not be needed soon
+    void drop(quint64 pos, quint64 len);
+#ifndef Q_OS_WIN
+    //Descriptor for asynchronous reads
+    int handle() const;
+#endif
+
+private:
+#ifdef Q_OS_WIN
+    void* m_handle;
+#else
+    int m_fd;
+#endif
+};
+
+#endif // RAWFILE_H
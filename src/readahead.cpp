@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "readahead.h"
+#include <QMutexLocker>
+
+//Bits prefetched per step before checking for a newer request
+#define READAHEAD_CHUNK (4*1024*1024*8ULL)
+
+ReadAhead::ReadAhead(QObject *parent) : QThread(parent)
+{
+    m_captureFile = 0;
+    m_offset = 0;
+    m_length = 0;
+    m_pending = false;
+    m_stop = false;
+}
+
+ReadAhead::~ReadAhead() {
+    m_mutex.lock();
+    m_stop = true;
+    m_wake.wakeOne();
+    m_mutex.unlock();
+    wait();
+}
+
+void ReadAhead::setCaptureFile(CaptureFile* captureFile) {
+    QMutexLocker busy(&m_busy);
+    QMutexLocker lock(&m_mutex);
+    m_captureFile = captureFile;
+    m_pending = false;
+}
+
+void ReadAhead::request(quint64 offset, quint64 length) {
+    QMutexLocker lock(&m_mutex);
+    m_offset = offset;
+    m_length = length;
+    m_pending = true;
+    m_wake.wakeOne();
+}
+
+void ReadAhead::run() {
+    quint64 offset, length, chunk;
+    for(;;) {
+        m_mutex.lock();
+        while( !m_pending && !m_stop ) {
+            m_wake.wait(&m_mutex);
+        }
+        if( m_stop ) {
+            m_mutex.unlock();
+            break;
+        }
+        offset = m_offset;
+        length = m_length;
+        m_pending = false;
+        m_mutex.unlock();
+
+        while( length ) {
+            chunk = qMin(length,READAHEAD_CHUNK);
+            m_busy.lock();
+            if( m_captureFile ) {
+                m_captureFile->prefetch(offset,chunk);
+            }
+            m_busy.unlock();
+            offset = offset + chunk;
+            length = length - chunk;
+
+            m_mutex.lock();
+            if( m_pending || m_stop ) {
+                length = 0;
+            }
+            m_mutex.unlock();
+        }
+    }
+}
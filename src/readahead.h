@@ -23,28 +23,41 @@
  * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#ifndef CAPTUREFILE_BITPERBIT_H
-#define CAPTUREFILE_BITPERBIT_H
+#ifndef READAHEAD_H
+#define READAHEAD_H
 
-#include<stdio.h>
-#include"capturefile.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include "capturefile.h"
 
-class CaptureFile_BitPerBit: public CaptureFile
+//Background thread that calls CaptureFile::prefetch() so data is in
+//memory before a repaint asks for it.  Only the latest request matters:
+//a new one replaces any pending request and stops the one in progress
+//at the next chunk.
+class ReadAhead : public QThread
 {
+    Q_OBJECT
 public:
-    CaptureFile_BitPerBit(QString path, bool invert=false);
-    virtual ~CaptureFile_BitPerBit();
-    virtual size_t tellbit();
-    virtual void seekbit(size_t offset);
-    virtual size_t sizebit();
-    virtual QBitArray* readbit(size_t readlen=1);
+    explicit ReadAhead(QObject *parent = 0);
+    ~ReadAhead();
+    //Waits for a prefetch of the old file to finish, so the old file
+    //can be deleted once this returns
+    void setCaptureFile(CaptureFile* captureFile);
+    void request(quint64 offset, quint64 length);
+
+protected:
+    virtual void run();
 
 private:
-    FILE* m_fp;
-    size_t m_fileSize;
-    bool m_invert;
-    unsigned char m_currentByte;
-    unsigned char m_bitOffset;
+    QMutex m_mutex;         //Guards the request
+    QMutex m_busy;          //Held while calling into the file
+    QWaitCondition m_wake;
+    CaptureFile* m_captureFile;
+    quint64 m_offset;
+    quint64 m_length;
+    bool m_pending;
+    bool m_stop;
 };
 
-#endif // CAPTUREFILE_BITPERBIT_H
+#endif // READAHEAD_H
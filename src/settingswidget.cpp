@@ -28,6 +28,7 @@
 #include <QIntValidator>
 #include <QColor>
 #include "tinyexpr.h"
+#include "overview.h"
 
 SettingsWidget::SettingsWidget(QWidget *parent):
     QWidget(parent)
@@ -71,6 +72,15 @@ SettingsWidget::SettingsWidget(QWidget *parent):
     connect(m_offsetw,SIGNAL(returnPressed()),this,SLOT(updateEmit()));
     layout->addWidget(m_offsetw,1,3);
 
+    m_shrinkl = new QLabel("Zoom out",this);
+    layout->addWidget(m_shrinkl,0,4);
+    m_shrinkw = new QComboBox(this);
+    for( int shrink=1; shrink<=OVERVIEW_MAX_SHRINK; shrink=shrink*2 ) {
+        m_shrinkw->addItem(QString("1:%1").arg(shrink));
+    }
+    connect(m_shrinkw,SIGNAL(currentIndexChanged(int)),this,SLOT(updateHandler()));
+    layout->addWidget(m_shrinkw,0,5);
+
     //layout->addWidget(new QLabel("Sync Pattern:",this),0,4);
     //m_syncw = new QLineEdit(this);
     //layout->addWidget(m_syncw,0,5);
@@ -172,12 +182,20 @@ void SettingsWidget::updateEmit() {
         m_fplw->setPalette(*m_errpal);
     }
 
-    result = te_interp(m_offsetw->text().toStdString().c_str(), &error);
-    if( ! error && result >= 0.0 ) {
-        m_offset = (int)result;
+    //Plain integers are taken as is so offsets past 2^53 stay exact
+    bool isInteger;
+    quint64 offset = m_offsetw->text().trimmed().toULongLong(&isInteger);
+    if( isInteger ) {
+        m_offset = offset;
         m_offsetw->setPalette(*m_okpal);
     } else {
-        m_offsetw->setPalette(*m_errpal);
+        result = te_interp(m_offsetw->text().toStdString().c_str(), &error);
+        if( ! error && result >= 0.0 ) {
+            m_offset = (quint64)result;
+            m_offsetw->setPalette(*m_okpal);
+        } else {
+            m_offsetw->setPalette(*m_errpal);
+        }
     }
 
     if( m_rbppw->value() || m_gbppw->value() || m_bbppw->value() ) {
@@ -251,16 +269,14 @@ void SettingsWidget::setFpl(int fpl) {
     }
 }
 
-int SettingsWidget::offset() {
+quint64 SettingsWidget::offset() {
     return m_offset;
 }
 
-void SettingsWidget::setOffset(int offset) {
-    if( offset >= 0 ) {
-        m_offsetw->setText(QString::number(offset));
-        if( offset != m_offset ) {
-            updateEmit();
-        }
+void SettingsWidget::setOffset(quint64 offset) {
+    m_offsetw->setText(QString::number(offset));
+    if( offset != m_offset ) {
+        updateEmit();
     }
 }
 
@@ -279,6 +295,21 @@ void SettingsWidget::setZoom(int zoom) {
     }
 }
 
+int SettingsWidget::shrink() {
+    return 1 << m_shrinkw->currentIndex();
+}
+
+void SettingsWidget::setShrink(int shrink) {
+    int index = 0;
+    while( (1 << index) < shrink && index < m_shrinkw->count()-1 ) {
+        index++;
+    }
+    if( index != m_shrinkw->currentIndex() && shrink >= 1 ) {
+        m_shrinkw->setCurrentIndex(index);
+        emit update();
+    }
+}
+
 int SettingsWidget::rbpp() {
     return m_rbpp;
 }
@@ -30,6 +30,7 @@
 #include<QLabel>
 #include<QLineEdit>
 #include<QSpinBox>
+#include<QComboBox>
 #include<QString>
 #include<QPushButton>
 #include<QPalette>
@@ -48,11 +49,14 @@ public:
     void setBpl(int bpl);
     int fpl();
     void setFpl(int fpl);
-    int offset();
-    void setOffset(int offset);
+    quint64 offset();
+    void setOffset(quint64 offset);
     //QString sync();
     int zoom();
     void setZoom(int zoom);
+    //Raster pixels per view pixel along each side when zoomed out
+    int shrink();
+    void setShrink(int shrink);
     int rbpp();
     void setRbpp(int rbpp);
     int gbpp();
@@ -85,11 +89,13 @@ private:
     int m_fpl;
     QLabel* m_offsetl;
     QLineEdit* m_offsetw;
-    int m_offset;
+    quint64 m_offset;
     //QLineEdit* m_syncw;
     //QString m_syncv;
     QLabel* m_zooml;
     QSpinBox* m_zoomw;
+    QLabel* m_shrinkl;
+    QComboBox* m_shrinkw;
     QLabel* m_rbppl;
     QSpinBox* m_rbppw;
     int m_rbpp;
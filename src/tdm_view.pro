@@ -17,6 +17,43 @@ TEMPLATE = app
 # deprecated API in order to know how to port your code away from it.
 DEFINES += QT_DEPRECATED_WARNINGS
 
+# Captures routinely exceed 2 GB, make stdio 64 bit on 32 bit platforms too
+DEFINES += _FILE_OFFSET_BITS=64
+
+# Compressed captures are read directly when zlib (gzip) and libzstd are
+# available
+packagesExist(zlib) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += zlib
+    DEFINES += TDM_HAVE_ZLIB
+}
+packagesExist(libzstd) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libzstd
+    DEFINES += TDM_HAVE_ZSTD
+}
+
+# Raster exports stream to PNG and TIFF files when libpng and libtiff are
+# available (PPM otherwise), other image formats are saved whole by Qt
+packagesExist(libpng) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libpng
+    DEFINES += TDM_HAVE_PNG
+}
+packagesExist(libtiff-4) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libtiff-4
+    DEFINES += TDM_HAVE_TIFF
+}
+
+# Batches of block reads go through io_uring on Linux when liburing is
+# available (a pool of pread() threads otherwise)
+linux:packagesExist(liburing) {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += liburing
+    DEFINES += TDM_HAVE_URING
+}
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -26,11 +63,25 @@ SOURCES += \
         main.cpp \
         mainwindow.cpp \
         capturefile.cpp \
-        capturefile_byteperbit.cpp \
-        capturefile_bitperbit.cpp \
+        bitkernels.cpp \
+        blockcache.cpp \
+        tilecache.cpp \
+        rasterrenderer.cpp \
+        tilerenderer.cpp \
+        overview.cpp \
+        bittransform.cpp \
+        rawfile.cpp \
+        blockreader.cpp \
+        readahead.cpp \
+        capturefile_rawfile.cpp \
+        capturefile_mmap.cpp \
+        capturefile_compressed.cpp \
+        capturefile_stream.cpp \
+        capturefile_segments.cpp \
         settingswidget.cpp \
     centralwidget.cpp \
     rasterwidget.cpp \
+    rasterwriter.cpp \
     tinyexpr.c \
     infodialog.cpp \
     channelselectiondialog.cpp
@@ -38,11 +89,25 @@ SOURCES += \
 HEADERS += \
         mainwindow.h \
         capturefile.h \
-        capturefile_byteperbit.h \
-        capturefile_bitperbit.h \
+        bitkernels.h \
+        blockcache.h \
+        tilecache.h \
+        rasterrenderer.h \
+        tilerenderer.h \
+        overview.h \
+        bittransform.h \
+        rawfile.h \
+        blockreader.h \
+        readahead.h \
+        capturefile_rawfile.h \
+        capturefile_mmap.h \
+        capturefile_compressed.h \
+        capturefile_stream.h \
+        capturefile_segments.h \
         settingswidget.h \
     centralwidget.h \
     rasterwidget.h \
+    rasterwriter.h \
     tinyexpr.h \
     infodialog.h \
     channelselectiondialog.h
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "tilecache.h"
+#include <QMutexLocker>
+
+//Bytes of one cached tile
+#define TILECACHE_TILE_BYTES (TILECACHE_TILE_SIZE*TILECACHE_TILE_SIZE*4)
+
+bool TileKey::operator==(const TileKey& other) const {
+    return offset == other.offset && ts == other.ts && bpts == other.bpts && fpl == other.fpl &&
+           rbpp == other.rbpp && gbpp == other.gbpp && bbpp == other.bbpp &&
+           transform == other.transform && shrink == other.shrink && row == other.row && column == other.column;
+}
+
+uint qHash(const TileKey& key) {
+    quint64 h = key.offset;
+    h = h*31 + key.ts;
+    h = h*31 + key.bpts;
+    h = h*31 + key.fpl;
+    h = h*31 + ((key.rbpp<<16) | (key.gbpp<<8) | key.bbpp);
+    h = h*31 + key.transform;
+    h = h*31 + key.shrink;
+    h = h*31 + key.row;
+    h = h*31 + key.column;
+    return (uint)(h ^ (h >> 32));
+}
+
+TileCache::TileCache(size_t budget) {
+    m_head = 0;
+    m_tail = 0;
+    m_budget = budget;
+    m_hits = 0;
+    m_misses = 0;
+}
+
+TileCache::~TileCache() {
+    clear();
+}
+
+size_t TileCache::budget() const {
+    QMutexLocker lock(&m_mutex);
+    return m_budget;
+}
+
+void TileCache::setBudget(size_t budget) {
+    QMutexLocker lock(&m_mutex);
+    m_budget = budget;
+    while( m_tail && (size_t)m_tiles.size()*TILECACHE_TILE_BYTES > m_budget ) {
+        release(m_tail);
+    }
+}
+
+QImage TileCache::lookup(const TileKey& key) {
+    QMutexLocker lock(&m_mutex);
+    Tile* tile = m_tiles.value(key,0);
+    if( tile == 0 ) {
+        m_misses++;
+        return QImage();
+    }
+    m_hits++;
+    if( tile != m_head ) {
+        unlink(tile);
+        pushFront(tile);
+    }
+    return tile->image;
+}
+
+void TileCache::insert(const TileKey& key, const QImage& image) {
+    QMutexLocker lock(&m_mutex);
+    Tile* tile = m_tiles.value(key,0);
+    if( m_budget < TILECACHE_TILE_BYTES ) {
+        return;
+    }
+    if( tile ) {
+        unlink(tile);
+    }
+    else {
+        if( (size_t)(m_tiles.size()+1)*TILECACHE_TILE_BYTES > m_budget ) {
+            release(m_tail);
+        }
+        tile = new Tile;
+        tile->key = key;
+        m_tiles.insert(key,tile);
+    }
+    tile->image = image;
+    pushFront(tile);
+}
+
+bool TileCache::contains(const TileKey& key) const {
+    QMutexLocker lock(&m_mutex);
+    return m_tiles.contains(key);
+}
+
+void TileCache::invalidateLines(quint64 line) {
+    QMutexLocker lock(&m_mutex);
+    Tile* tile = m_head;
+    Tile* next;
+    while( tile ) {
+        next = tile->next;
+        if( (tile->key.row+1)*TILECACHE_TILE_SIZE*tile->key.shrink > line ) {
+            release(tile);
+        }
+        tile = next;
+    }
+}
+
+void TileCache::clear() {
+    QMutexLocker lock(&m_mutex);
+    while( m_tail ) {
+        release(m_tail);
+    }
+}
+
+quint64 TileCache::hits() const {
+    QMutexLocker lock(&m_mutex);
+    return m_hits;
+}
+
+quint64 TileCache::misses() const {
+    QMutexLocker lock(&m_mutex);
+    return m_misses;
+}
+
+void TileCache::unlink(Tile* tile) {
+    if( tile->prev ) {
+        tile->prev->next = tile->next;
+    }
+    else {
+        m_head = tile->next;
+    }
+    if( tile->next ) {
+        tile->next->prev = tile->prev;
+    }
+    else {
+        m_tail = tile->prev;
+    }
+}
+
+void TileCache::pushFront(Tile* tile) {
+    tile->prev = 0;
+    tile->next = m_head;
+    if( m_head ) {
+        m_head->prev = tile;
+    }
+    else {
+        m_tail = tile;
+    }
+    m_head = tile;
+}
+
+void TileCache::release(Tile* tile) {
+    unlink(tile);
+    m_tiles.remove(tile->key);
+    delete tile;
+}
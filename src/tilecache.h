@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include<QtGlobal>
+#include<QHash>
+#include<QMutex>
+#include<QImage>
+
+//Pixels along each side of a tile (tiles are rendered at zoom 1, or as
+//overview cells when shrunk) and the default memory budget for all tiles
+#define TILECACHE_TILE_SIZE 256
+#define TILECACHE_DEFAULT_BUDGET (64*1024*1024)
+
+//A rendered tile is only good for the layout it was rendered with
+struct TileKey {
+    quint64 offset;         //File offset
+    quint32 ts;
+    quint32 bpts;
+    quint32 fpl;
+    quint32 rbpp;
+    quint32 gbpp;
+    quint32 bbpp;
+    int transform;          //BitTransform flags
+    quint32 shrink;         //Raster pixels per tile pixel along each side
+    quint64 row;            //Tile row and column in the raster
+    quint64 column;
+
+    bool operator==(const TileKey& other) const;
+};
+uint qHash(const TileKey& key);
+
+//Keeps the most recently drawn tiles of the raster.  When the budget is
+//used up the least recently used tile is dropped.  Safe to use from
+//several threads.
+class TileCache
+{
+public:
+    TileCache(size_t budget=TILECACHE_DEFAULT_BUDGET);
+    ~TileCache();
+    size_t budget() const;
+    void setBudget(size_t budget);
+    //Returns a null image if the tile is not cached
+    QImage lookup(const TileKey& key);
+    void insert(const TileKey& key, const QImage& tile);
+    //Does not count as a hit or miss
+    bool contains(const TileKey& key) const;
+    //Drops the tiles of every layout reaching raster line line or past
+    //it, they showed the end of a capture that has since grown
+    void invalidateLines(quint64 line);
+    void clear();
+    quint64 hits() const;
+    quint64 misses() const;
+
+private:
+    struct Tile {
+        TileKey key;
+        QImage image;
+        Tile* prev;
+        Tile* next;
+    };
+    void unlink(Tile* tile);
+    void pushFront(Tile* tile);
+    void release(Tile* tile);
+
+    mutable QMutex m_mutex;
+    QHash<TileKey,Tile*> m_tiles;
+    Tile* m_head;
+    Tile* m_tail;
+    size_t m_budget;
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // TILECACHE_H
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "tilerenderer.h"
+#include <QMutexLocker>
+#include <QMetaType>
+
+TileRenderer::TileRenderer(TileCache* tiles, Overview* overview, QObject *parent) : QThread(parent)
+{
+    m_tiles = tiles;
+    m_overview = overview;
+    m_captureFile = 0;
+    m_rendering = false;
+    m_stop = false;
+    //tileReady() crosses to the widget's thread
+    qRegisterMetaType<quint64>("quint64");
+}
+
+TileRenderer::~TileRenderer() {
+    m_mutex.lock();
+    m_stop = true;
+    m_cancel.storeRelease(1);
+    m_wake.wakeOne();
+    m_mutex.unlock();
+    wait();
+}
+
+void TileRenderer::setCaptureFile(CaptureFile* captureFile) {
+    m_mutex.lock();
+    m_keys.clear();
+    m_cancel.storeRelease(1);
+    m_mutex.unlock();
+    QMutexLocker busy(&m_busy);
+    QMutexLocker lock(&m_mutex);
+    m_captureFile = captureFile;
+}
+
+void TileRenderer::request(const RasterLayout& layout, const QList<TileKey>& keys) {
+    QMutexLocker lock(&m_mutex);
+    m_layout = layout;
+    m_keys = keys;
+    if( m_rendering ) {
+        if( m_keys.contains(m_current) ) {
+            m_keys.removeAll(m_current);
+        }
+        else {
+            m_cancel.storeRelease(1);
+        }
+    }
+    if( !m_keys.isEmpty() ) {
+        m_wake.wakeOne();
+    }
+}
+
+void TileRenderer::run() {
+    TileKey key;
+    RasterLayout layout;
+    QImage tile;
+    bool done;
+    for(;;) {
+        m_mutex.lock();
+        while( m_keys.isEmpty() && !m_stop ) {
+            m_wake.wait(&m_mutex);
+        }
+        if( m_stop ) {
+            m_mutex.unlock();
+            break;
+        }
+        key = m_keys.takeFirst();
+        layout = m_layout;
+        m_current = key;
+        m_rendering = true;
+        m_cancel.storeRelease(0);
+        m_mutex.unlock();
+
+        tile = QImage(TILECACHE_TILE_SIZE,TILECACHE_TILE_SIZE,QImage::Format_RGB32);
+        m_busy.lock();
+        if( m_captureFile == 0 ) {
+            done = false;
+        }
+        else if( key.shrink > 1 ) {
+            done = m_overview->render(m_captureFile,layout,&tile,key.row*TILECACHE_TILE_SIZE,key.column*TILECACHE_TILE_SIZE,
+                                      key.shrink,&m_cancel);
+        }
+        else {
+            done = m_renderer.render(m_captureFile,layout,&tile,key.row*TILECACHE_TILE_SIZE,key.column*TILECACHE_TILE_SIZE,
+                                     1,0,TILECACHE_TILE_SIZE,&m_cancel);
+        }
+        //A transform set while rendering may have changed some of the bits
+        if( done && m_captureFile->transform().flags() == layout.transform ) {
+            m_tiles->insert(key,tile);
+        }
+        else {
+            done = false;
+        }
+        m_busy.unlock();
+
+        m_mutex.lock();
+        m_rendering = false;
+        m_mutex.unlock();
+        if( done ) {
+            emit tileReady(key.row,key.column);
+        }
+    }
+}
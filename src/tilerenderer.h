@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022, Daniel Tabor
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QAtomicInt>
+#include "capturefile.h"
+#include "rasterrenderer.h"
+#include "tilecache.h"
+#include "overview.h"
+
+//Background thread that renders the tiles a repaint found missing into
+//the tile cache, so painting never waits for the file.  Only the latest
+//request matters: a new one replaces the waiting tiles, and the tile in
+//progress is abandoned unless it is still wanted.
+class TileRenderer : public QThread
+{
+    Q_OBJECT
+public:
+    //Tiles of a shrunk raster come from overview
+    TileRenderer(TileCache* tiles, Overview* overview, QObject *parent = 0);
+    ~TileRenderer();
+    //Waits for a tile of the old file to finish, so the old file can be
+    //deleted once this returns
+    void setCaptureFile(CaptureFile* captureFile);
+    //keys are rendered in order with layout
+    void request(const RasterLayout& layout, const QList<TileKey>& keys);
+
+signals:
+    //The tile is in the cache
+    void tileReady(quint64 row, quint64 column);
+
+protected:
+    virtual void run();
+
+private:
+    TileCache* m_tiles;
+    Overview* m_overview;
+    RasterRenderer m_renderer;
+    QMutex m_mutex;         //Guards the request
+    QMutex m_busy;          //Held while calling into the file
+    QWaitCondition m_wake;
+    CaptureFile* m_captureFile;
+    RasterLayout m_layout;
+    QList<TileKey> m_keys;
+    TileKey m_current;      //Tile in progress, if m_rendering
+    bool m_rendering;
+    QAtomicInt m_cancel;
+    bool m_stop;
+};
+
+#endif // TILERENDERER_H